@@ -0,0 +1,197 @@
+#include "BiomeDefinition.h"
+#include "ProceduralSurvival.h"
+
+FBiomeWeights FBiomeWeights::Bilinear(const FBiomeWeights& W00, const FBiomeWeights& W10, const FBiomeWeights& W01, const FBiomeWeights& W11, float AlphaX, float AlphaY)
+{
+	FBiomeWeights Result;
+	Result.Num = W00.Num;
+
+	for (int32 i = 0; i < Result.Num; i++)
+	{
+		const float Top = FMath::Lerp(W00.Weights[i], W10.Weights[i], AlphaX);
+		const float Bottom = FMath::Lerp(W01.Weights[i], W11.Weights[i], AlphaX);
+		Result.Weights[i] = FMath::Lerp(Top, Bottom, AlphaY);
+	}
+
+	return Result;
+}
+
+void FBiomeTable::Compile(const TArray<UBiomeDefinition*>& Definitions)
+{
+	Entries.Reset();
+
+	for (const UBiomeDefinition* Definition : Definitions)
+	{
+		if (!Definition) continue;
+
+		if (Entries.Num() == FBiomeWeights::MaxBiomes)
+		{
+			UE_LOG(LogProceduralSurvival, Warning, TEXT("Only the first %d biomes are used, %s is ignored"), FBiomeWeights::MaxBiomes, *Definition->GetName());
+			continue;
+		}
+
+		FEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.Color = Definition->Color;
+		Entry.LowerEdge = Definition->LowerEdge;
+		Entry.UpperEdge = Definition->UpperEdge;
+		Entry.BlendWidth = FMath::Max(Definition->BlendWidth, 0.001f);
+		Entry.WeightScale = FMath::Max(Definition->WeightScale, 0.0f);
+		Entry.bFillsRemainder = Definition->bFillsRemainder;
+		Entry.Frequency = Definition->Frequency;
+		Entry.Amplitude = Definition->Amplitude;
+		Entry.BaseHeight = Definition->BaseHeight;
+		Entry.bRidged = Definition->Shape == EBiomeNoiseShape::Ridged;
+		Entry.NumOctaves = FMath::Min(Definition->OctaveWeights.Num(), MaxOctaves);
+
+		for (int32 Octave = 0; Octave < Entry.NumOctaves; Octave++)
+		{
+			Entry.OctaveWeights[Octave] = Definition->OctaveWeights[Octave];
+		}
+
+		Entry.SurfaceMaterial = Definition->SurfaceMaterial;
+		Entry.SubsurfaceMaterial = Definition->SubsurfaceMaterial;
+		Entry.DeepMaterial = Definition->DeepMaterial;
+		Entry.SubsurfaceDepth = FMath::Max(Definition->SubsurfaceDepth, 1.0f);
+		Entry.MaxSurfaceSlope = FMath::Max(Definition->MaxSurfaceSlope, 0.0f);
+		Entry.SnowHeight = Definition->SnowHeight;
+	}
+
+	if (Entries.Num() == 0)
+	{
+		Entries = GetDefault().Entries;
+	}
+}
+
+FBiomeWeights FBiomeTable::WeightsFromNoise(float BiomeNoise) const
+{
+	float t = (BiomeNoise + 1.0f) * 0.5f;
+
+	FBiomeWeights Weights;
+	Weights.Num = Entries.Num();
+
+	// Banded biomes first: rising at the lower edge, falling at the upper one
+	float Remainder = 1.0f;
+
+	for (int32 i = 0; i < Entries.Num(); i++)
+	{
+		const FEntry& Entry = Entries[i];
+		if (Entry.bFillsRemainder) continue;
+
+		const float Rise = Entry.LowerEdge > 0.0f ? FMath::SmoothStep(Entry.LowerEdge - Entry.BlendWidth, Entry.LowerEdge + Entry.BlendWidth, t) : 1.0f;
+		const float Fall = Entry.UpperEdge < 1.0f ? FMath::SmoothStep(Entry.UpperEdge - Entry.BlendWidth, Entry.UpperEdge + Entry.BlendWidth, t) : 0.0f;
+
+		Weights.Weights[i] = FMath::Max((Rise - Fall) * Entry.WeightScale, 0.0f);
+		Remainder -= Weights.Weights[i];
+	}
+
+	Remainder = FMath::Clamp(Remainder, 0.0f, 1.0f);
+
+	float sum = 0.0f;
+
+	for (int32 i = 0; i < Entries.Num(); i++)
+	{
+		if (Entries[i].bFillsRemainder) Weights.Weights[i] = Remainder;
+		sum += Weights.Weights[i];
+	}
+
+	if (sum > 0.0f)
+	{
+		for (int32 i = 0; i < Weights.Num; i++)
+		{
+			Weights.Weights[i] /= sum;
+		}
+	}
+
+	return Weights;
+}
+
+float FBiomeTable::HeightFromOctaves(int32 Biome, const float* Octaves) const
+{
+	const FEntry& Entry = Entries[Biome];
+
+	float n = 0.0f;
+
+	for (int32 Octave = 0; Octave < Entry.NumOctaves; Octave++)
+	{
+		float Value = Octaves[Octave];
+
+		if (Entry.bRidged)
+		{
+			Value = 1.0f - FMath::Abs(Value);
+			Value = Value * Value;
+		}
+
+		n += Entry.OctaveWeights[Octave] * Value;
+	}
+
+	return n * Entry.Amplitude + Entry.BaseHeight;
+}
+
+EVoxelMaterial FBiomeTable::GetMaterial(uint8 Biome, float Height, float Slope, float Depth) const
+{
+	if (!Entries.IsValidIndex(Biome)) return EVoxelMaterial::Stone;
+
+	const FEntry& Entry = Entries[Biome];
+	const bool bSteep = Slope > Entry.MaxSurfaceSlope;
+
+	// The top voxel holds the surface, which is all a smooth mesh shows of a column
+	if (Depth < 1.0f)
+	{
+		if (Entry.SnowHeight > 0.0f && Height >= Entry.SnowHeight) return EVoxelMaterial::Snow;
+		return bSteep ? Entry.DeepMaterial : Entry.SurfaceMaterial;
+	}
+
+	// Cliffs are bare all the way down
+	if (Depth < Entry.SubsurfaceDepth && !bSteep) return Entry.SubsurfaceMaterial;
+
+	return Entry.DeepMaterial;
+}
+
+const FBiomeTable& FBiomeTable::GetDefault()
+{
+	static const FBiomeTable Default = []()
+	{
+		FBiomeTable Table;
+
+		FEntry& Plains = Table.Entries.AddDefaulted_GetRef();
+		Plains.Color = FColor::Green;
+		Plains.UpperEdge = 0.33f;
+		Plains.WeightScale = 1.1f;
+		Plains.Frequency = 0.006f;
+		Plains.Amplitude = 15.0f;
+		Plains.BaseHeight = 10.0f;
+		Plains.NumOctaves = 2;
+		Plains.OctaveWeights[0] = 0.7f;
+		Plains.OctaveWeights[1] = 0.2f;
+
+		FEntry& Hills = Table.Entries.AddDefaulted_GetRef();
+		Hills.Color = FColor::Blue;
+		Hills.bFillsRemainder = true;
+		Hills.Frequency = 0.008f;
+		Hills.Amplitude = 25.0f;
+		Hills.BaseHeight = 25.0f;
+		Hills.NumOctaves = 3;
+		Hills.OctaveWeights[0] = 0.6f;
+		Hills.OctaveWeights[1] = 0.3f;
+		Hills.OctaveWeights[2] = 0.1f;
+
+		FEntry& Mountains = Table.Entries.AddDefaulted_GetRef();
+		Mountains.Color = FColor::Red;
+		Mountains.LowerEdge = 0.66f;
+		Mountains.Frequency = 0.005f;
+		Mountains.Amplitude = 45.0f;
+		Mountains.BaseHeight = 40.0f;
+		Mountains.bRidged = true;
+		Mountains.NumOctaves = 2;
+		Mountains.OctaveWeights[0] = 1.0f;
+		Mountains.OctaveWeights[1] = 0.5f;
+		Mountains.SurfaceMaterial = EVoxelMaterial::Stone;
+		Mountains.SubsurfaceMaterial = EVoxelMaterial::Stone;
+		Mountains.MaxSurfaceSlope = 1.0f;
+		Mountains.SnowHeight = 95.0f;
+
+		return Table;
+	}();
+
+	return Default;
+}
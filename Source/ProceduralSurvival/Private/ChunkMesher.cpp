@@ -0,0 +1,964 @@
+#include "ChunkMesher.h"
+#include "TerrainGenerator.h"
+#include "MarchingCubeTables.h"
+
+namespace
+{
+	// Where each marching-cubes edge lives in the lattice: the offset of the point it starts from
+	// (relative to the cell's first corner), the axis it runs along, and the corners it interpolates between
+	struct FCellEdge
+	{
+		uint8 DX, DY, DZ;
+		uint8 Axis;
+		uint8 From, To;
+	};
+
+	const FCellEdge CellEdges[12] =
+	{
+		{ 0, 0, 0, 0, 0, 1 },
+		{ 1, 0, 0, 1, 1, 2 },
+		{ 0, 1, 0, 0, 2, 3 },
+		{ 0, 0, 0, 1, 3, 0 },
+		{ 0, 0, 1, 0, 4, 5 },
+		{ 1, 0, 1, 1, 5, 6 },
+		{ 0, 1, 1, 0, 6, 7 },
+		{ 0, 0, 1, 1, 7, 4 },
+		{ 0, 0, 0, 2, 0, 4 },
+		{ 1, 0, 0, 2, 1, 5 },
+		{ 1, 1, 0, 2, 2, 6 },
+		{ 0, 1, 0, 2, 3, 7 }
+	};
+
+	// Lattice offset of each cell corner, in the corner order the tables use
+	const FIntVector CellCorners[8] =
+	{
+		FIntVector(0, 0, 0), FIntVector(1, 0, 0), FIntVector(1, 1, 0), FIntVector(0, 1, 0),
+		FIntVector(0, 0, 1), FIntVector(1, 0, 1), FIntVector(1, 1, 1), FIntVector(0, 1, 1)
+	};
+
+	// One cube face direction for the greedy mesher, in AddCubeFace order (Right, Left, Front, Back, Top, Bottom).
+	// Faces lie on a plane across Axis and are merged over the U/V axes; Corners gives each quad vertex as
+	// (U, V) in 0..1, in the same winding AddCubeFace uses.
+	struct FGreedyFace
+	{
+		int32 Axis;
+		int32 Direction;
+		int32 U, V;
+		FIntPoint Corners[4];
+	};
+
+	const FGreedyFace GreedyFaces[6] =
+	{
+		{ 0,  1, 1, 2, { FIntPoint(0, 0), FIntPoint(0, 1), FIntPoint(1, 1), FIntPoint(1, 0) } },
+		{ 0, -1, 1, 2, { FIntPoint(0, 0), FIntPoint(1, 0), FIntPoint(1, 1), FIntPoint(0, 1) } },
+		{ 1,  1, 0, 2, { FIntPoint(0, 0), FIntPoint(1, 0), FIntPoint(1, 1), FIntPoint(0, 1) } },
+		{ 1, -1, 0, 2, { FIntPoint(0, 0), FIntPoint(0, 1), FIntPoint(1, 1), FIntPoint(1, 0) } },
+		{ 2,  1, 0, 1, { FIntPoint(0, 0), FIntPoint(0, 1), FIntPoint(1, 1), FIntPoint(1, 0) } },
+		{ 2, -1, 0, 1, { FIntPoint(0, 0), FIntPoint(1, 0), FIntPoint(1, 1), FIntPoint(0, 1) } }
+	};
+}
+
+void FChunkMeshData::Reset()
+{
+	Vertices.Reset();
+	Triangles.Reset();
+	Normals.Reset();
+	UVs.Reset();
+	VertexColors.Reset();
+	TriangleMaterials.Reset();
+	Sections.Reset();
+}
+
+int32 FChunkMeshData::GetNumTriangles() const
+{
+	int32 Num = Triangles.Num() / 3;
+	for (const FChunkMeshSection& Section : Sections) Num += Section.Triangles.Num() / 3;
+	return Num;
+}
+
+int32 FChunkMeshData::GetNumVertices() const
+{
+	int32 Num = Vertices.Num();
+	for (const FChunkMeshSection& Section : Sections) Num += Section.Vertices.Num();
+	return Num;
+}
+
+SIZE_T FChunkMeshData::GetAllocatedSize() const
+{
+	SIZE_T Size = Vertices.GetAllocatedSize() + Triangles.GetAllocatedSize() + Normals.GetAllocatedSize() + UVs.GetAllocatedSize() +
+		VertexColors.GetAllocatedSize() + TriangleMaterials.GetAllocatedSize() + Sections.GetAllocatedSize();
+
+	for (const FChunkMeshSection& Section : Sections)
+	{
+		Size += Section.Vertices.GetAllocatedSize() + Section.Triangles.GetAllocatedSize() + Section.Normals.GetAllocatedSize() +
+			Section.UVs.GetAllocatedSize() + Section.VertexColors.GetAllocatedSize();
+	}
+
+	return Size;
+}
+
+void FChunkDensityGrid::Init(int32 ChunkSizeXY, int32 ChunkHeightZ)
+{
+	SizeXY = ChunkSizeXY + 3;
+	SizeZ = ChunkHeightZ + 3;
+	Values.SetNumUninitialized(SizeXY * SizeXY * SizeZ);
+}
+
+void FChunkSolidMask::Init(int32 ChunkSizeXY, int32 ChunkHeightZ)
+{
+	SizeXY = ChunkSizeXY + 2;
+	SizeZ = ChunkHeightZ + 2;
+	Values.SetNumUninitialized(SizeXY * SizeXY * SizeZ);
+}
+
+int32 FChunkMeshInput::BorderColumnIndex(int32 X, int32 Y) const
+{
+	const int32 Size = ChunkSizeXY;
+	const int32 RowLength = Size + 3;
+
+	if (X < -1 || X > Size + 1 || Y < -1 || Y > Size + 1) return INDEX_NONE;
+
+	// Full rows at Y = -1, Size and Size + 1, then three columns (X = -1, Size, Size + 1) for each row in between
+	if (Y == -1) return X + 1;
+	if (Y >= Size) return RowLength * (1 + Y - Size) + X + 1;
+	if (X == -1) return RowLength * 3 + Y * 3;
+	if (X >= Size) return RowLength * 3 + Y * 3 + 1 + (X - Size);
+
+	return INDEX_NONE;
+}
+
+FChunkMesher::FChunkMesher(const FChunkMeshInput& InInput, const FVoxelStorage& InVoxels)
+	: Input(InInput)
+	, Voxels(InVoxels)
+{
+	const int32 LodStride = Input.LodStride;
+	if (LodStride > 1 && Input.ChunkSizeXY % LodStride == 0 && Input.ChunkHeightZ % LodStride == 0)
+	{
+		Stride = LodStride;
+	}
+
+	CellsXY = Input.ChunkSizeXY / Stride;
+	CellsZ = Input.ChunkHeightZ / Stride;
+}
+
+void FChunkMesher::Build(FChunkMeshData& Out) const
+{
+	Out.Reset();
+
+	if (Input.RenderMode == EVoxelRenderMode::Cubes)
+	{
+		BuildCubic(Out);
+	}
+	else if (Input.RenderMode == EVoxelRenderMode::GreedyCubes)
+	{
+		BuildGreedyCubes(Out);
+	}
+	else if (Input.RenderMode == EVoxelRenderMode::MarchingCubes)
+	{
+		BuildMarchingCubes(Out);
+		AddSkirts(Out);
+	}
+
+	SplitByMaterial(Out);
+}
+
+FColor FChunkMesher::GetMaterialDebugColor(uint8 Material)
+{
+	switch ((EVoxelMaterial)Material)
+	{
+	case EVoxelMaterial::Grass:
+		return FColor(72, 140, 48);
+	case EVoxelMaterial::Stone:
+		return FColor(128, 128, 128);
+	case EVoxelMaterial::Snow:
+		return FColor::White;
+	case EVoxelMaterial::Dirt:
+	default:
+		return FColor(110, 78, 48);
+	}
+}
+
+void FChunkMesher::SplitByMaterial(FChunkMeshData& Out) const
+{
+	const int32 NumTriangles = Out.Triangles.Num() / 3;
+
+	int32 NumPerMaterial[256] = {};
+	for (uint8 Material : Out.TriangleMaterials) NumPerMaterial[Material]++;
+
+	auto HasDebugColor = [this](int32 Material) { return Material < 32 && (Input.DebugColorMaterials & (1u << Material)) != 0; };
+
+	for (int32 Material = 0; Material < 256; Material++)
+	{
+		if (NumPerMaterial[Material] == 0) continue;
+
+		FChunkMeshSection& Section = Out.Sections.AddDefaulted_GetRef();
+		Section.Material = (uint8)Material;
+
+		// Most chunks show a single material and hand their streams over as they are
+		if (NumPerMaterial[Material] == NumTriangles)
+		{
+			Section.Vertices = MoveTemp(Out.Vertices);
+			Section.Triangles = MoveTemp(Out.Triangles);
+			Section.Normals = MoveTemp(Out.Normals);
+			Section.UVs = MoveTemp(Out.UVs);
+		}
+		else
+		{
+			TArray<int32> Remap;
+			Remap.Init(INDEX_NONE, Out.Vertices.Num());
+
+			Section.Triangles.Reserve(NumPerMaterial[Material] * 3);
+
+			for (int32 t = 0; t < NumTriangles; t++)
+			{
+				if (Out.TriangleMaterials[t] != Material) continue;
+
+				for (int32 Corner = 0; Corner < 3; Corner++)
+				{
+					const int32 Vertex = Out.Triangles[t * 3 + Corner];
+					int32& Mapped = Remap[Vertex];
+
+					if (Mapped == INDEX_NONE)
+					{
+						Mapped = Section.Vertices.Add(Out.Vertices[Vertex]);
+						Section.Normals.Add(Out.Normals[Vertex]);
+						Section.UVs.Add(Out.UVs[Vertex]);
+					}
+
+					Section.Triangles.Add(Mapped);
+				}
+			}
+		}
+
+		if (HasDebugColor(Material))
+		{
+			Section.VertexColors.Init(GetMaterialDebugColor((uint8)Material), Section.Vertices.Num());
+		}
+	}
+
+	Out.Vertices.Reset();
+	Out.Triangles.Reset();
+	Out.Normals.Reset();
+	Out.UVs.Reset();
+	Out.VertexColors.Reset();
+	Out.TriangleMaterials.Reset();
+}
+
+void FChunkMesher::BuildSolidMask(FChunkSolidMask& Mask) const
+{
+	const int32 ChunkSizeXY = Input.ChunkSizeXY;
+	const int32 ChunkHeightZ = Input.ChunkHeightZ;
+
+	Mask.Init(CellsXY, CellsZ);
+
+	for (int32 z = -1; z <= CellsZ; ++z)
+	{
+		const bool bOutside = z < 0;
+
+		for (int32 y = -1; y <= CellsXY; ++y)
+		{
+			for (int32 x = -1; x <= CellsXY; ++x)
+			{
+				Mask.Values[Mask.Index(x, y, z)] = bOutside;
+			}
+		}
+	}
+
+	if (!Voxels.HasSameSize(ChunkSizeXY, ChunkHeightZ)) return;
+
+	for (int32 z = 0; z < CellsZ; ++z)
+	{
+		for (int32 y = 0; y < CellsXY; ++y)
+		{
+			bool* Dest = &Mask.Values[Mask.Index(0, y, z)];
+
+			for (int32 x = 0; x < CellsXY; ++x)
+			{
+				Dest[x] = Voxels.IsSolid(x * Stride, y * Stride, z * Stride);
+			}
+		}
+	}
+
+	// Border order matches FChunkMeshInput::BorderSolid: +X, -X, +Y, -Y, +Z, -Z
+	for (int32 Side = 0; Side < 4; ++Side)
+	{
+		const TArray<bool>& Border = Input.BorderSolid[Side];
+		if (Border.Num() != ChunkSizeXY * ChunkHeightZ || Input.HasLodSeam(Side)) continue;
+
+		for (int32 z = 0; z < CellsZ; ++z)
+		{
+			for (int32 Along = 0; Along < CellsXY; ++Along)
+			{
+				int32 x = Along;
+				int32 y = Along;
+
+				switch (Side)
+				{
+				case 0: x = CellsXY; break;
+				case 1: x = -1; break;
+				case 2: y = CellsXY; break;
+				case 3: y = -1; break;
+				}
+
+				Mask.Values[Mask.Index(x, y, z)] = Border[Along * Stride + z * Stride * ChunkSizeXY];
+			}
+		}
+	}
+
+	for (int32 Side = 4; Side < 6; ++Side)
+	{
+		const TArray<bool>& Border = Input.BorderSolid[Side];
+		if (Border.Num() != ChunkSizeXY * ChunkSizeXY) continue;
+
+		const int32 z = Side == 4 ? CellsZ : -1;
+
+		for (int32 y = 0; y < CellsXY; ++y)
+		{
+			for (int32 x = 0; x < CellsXY; ++x)
+			{
+				Mask.Values[Mask.Index(x, y, z)] = Border[x * Stride + y * Stride * ChunkSizeXY];
+			}
+		}
+	}
+}
+
+void FChunkMesher::AddCubeFace(int FaceIndex, const FVector& Position, uint8 Material, FChunkMeshData& Out) const
+{
+	const float S = Input.VoxelScale * Stride;
+
+	struct FCubeFace
+	{
+		FVector Normal;
+		FVector Verts[4];
+	};
+
+	const FCubeFace Faces[6] =
+	{
+		// Right
+		{ FVector(1,0,0), {
+			Position + FVector(S,0,0),
+			Position + FVector(S,0,S),
+			Position + FVector(S,S,S),
+			Position + FVector(S,S,0) }
+		},
+
+		// Left
+		{ FVector(-1,0,0), {
+			Position + FVector(0,0,0),
+			Position + FVector(0,S,0),
+			Position + FVector(0,S,S),
+			Position + FVector(0,0,S) }
+		},
+
+		// Front
+		{ FVector(0,1,0), {
+			Position + FVector(0,S,0),
+			Position + FVector(S,S,0),
+			Position + FVector(S,S,S),
+			Position + FVector(0,S,S) }
+		},
+
+		// Back
+		{ FVector(0,-1,0), {
+			Position + FVector(0,0,0),
+			Position + FVector(0,0,S),
+			Position + FVector(S,0,S),
+			Position + FVector(S,0,0) }
+		},
+
+		// Top
+		{ FVector(0,0,1), {
+			Position + FVector(0,0,S),
+			Position + FVector(0,S,S),
+			Position + FVector(S,S,S),
+			Position + FVector(S,0,S) }
+		},
+
+		// Bottom
+		{ FVector(0,0,-1), {
+			Position + FVector(0,0,0),
+			Position + FVector(S,0,0),
+			Position + FVector(S,S,0),
+			Position + FVector(0,S,0) }
+		}
+	};
+
+	const int32 Start = Out.Vertices.Num();
+
+	// Add vertices
+	for (int i = 0; i < 4; ++i)
+	{
+		Out.Vertices.Add(Faces[FaceIndex].Verts[i]);
+		Out.Normals.Add(Faces[FaceIndex].Normal);
+		Out.UVs.Add(FVector2D((i == 1 || i == 2), (i == 2 || i == 3)));
+	}
+
+	// Add triangles
+	Out.Triangles.Add(Start + 0);
+	Out.Triangles.Add(Start + 1);
+	Out.Triangles.Add(Start + 2);
+
+	Out.Triangles.Add(Start + 0);
+	Out.Triangles.Add(Start + 2);
+	Out.Triangles.Add(Start + 3);
+
+	Out.TriangleMaterials.Add(Material);
+	Out.TriangleMaterials.Add(Material);
+}
+
+void FChunkMesher::BuildCubic(FChunkMeshData& Out) const
+{
+	const int32 ChunkSizeXY = Input.ChunkSizeXY;
+	const float CellScale = Input.VoxelScale * Stride;
+
+	FChunkSolidMask Solid;
+	BuildSolidMask(Solid);
+
+	const int32 StrideY = Solid.SizeXY;
+	const int32 StrideZ = Solid.SizeXY * Solid.SizeXY;
+
+	const int EstimatedFaces = CellsXY * CellsXY * CellsZ;
+	Out.Vertices.Reserve(EstimatedFaces * 4);
+	Out.Triangles.Reserve(EstimatedFaces * 6);
+	Out.Normals.Reserve(EstimatedFaces * 4);
+	Out.UVs.Reserve(EstimatedFaces * 4);
+	Out.TriangleMaterials.Reserve(EstimatedFaces * 2);
+
+	for (int x = 0; x < CellsXY; x++)
+	{
+		for (int y = 0; y < CellsXY; y++)
+		{
+			for (int z = 0; z < CellsZ; z++)
+			{
+				const bool* Voxel = &Solid.Values[Solid.Index(x, y, z)];
+				if (!*Voxel) continue;
+
+				const FVector BasePos = FVector(
+					x * CellScale,
+					y * CellScale,
+					z * CellScale
+				);
+
+				const uint8 Material = Voxels.GetMaterial(x * Stride, y * Stride, z * Stride);
+
+				// Check neighbors and add faces if neighbor is empty
+				if (!Voxel[1]) AddCubeFace(0, BasePos, Material, Out); // Right
+				if (!Voxel[-1]) AddCubeFace(1, BasePos, Material, Out); // Left
+				if (!Voxel[StrideY]) AddCubeFace(2, BasePos, Material, Out); // Front
+				if (!Voxel[-StrideY]) AddCubeFace(3, BasePos, Material, Out); // Back
+				if (!Voxel[StrideZ]) AddCubeFace(4, BasePos, Material, Out); // Top
+				if (!Voxel[-StrideZ]) AddCubeFace(5, BasePos, Material, Out); // Bottom
+			}
+		}
+	}
+}
+
+uint32 FChunkMesher::GetGreedyFaceKey(int FaceIndex, int X, int Y, int Z, const FChunkSolidMask& Solid) const
+{
+	if (!Solid.IsSolid(X, Y, Z)) return 0;
+
+	const FGreedyFace& Face = GreedyFaces[FaceIndex];
+
+	int32 Neighbor[3] = { X, Y, Z };
+	Neighbor[Face.Axis] += Face.Direction;
+
+	if (Solid.IsSolid(Neighbor[0], Neighbor[1], Neighbor[2])) return 0;
+
+	// Faces only merge within one material, since each material is its own section
+	return 1 + (uint32)Voxels.GetMaterial(X * Stride, Y * Stride, Z * Stride);
+}
+
+void FChunkMesher::AddGreedyQuad(int FaceIndex, int Slice, int U, int V, int Width, int Height, uint8 Material, FChunkMeshData& Out) const
+{
+	const FGreedyFace& Face = GreedyFaces[FaceIndex];
+
+	FVector Normal = FVector::ZeroVector;
+	Normal[Face.Axis] = Face.Direction;
+
+	// AddCubeFace's UVs step along the first edge, then the second. Scale them by the quad's extent
+	// on those edges so textures keep one tile per voxel.
+	const bool bFirstEdgeAlongU = Face.Corners[1].X != Face.Corners[0].X;
+	const float FirstExtent = (bFirstEdgeAlongU ? Width : Height) * Stride;
+	const float SecondExtent = (bFirstEdgeAlongU ? Height : Width) * Stride;
+
+	const int32 Start = Out.Vertices.Num();
+
+	for (int i = 0; i < 4; ++i)
+	{
+		FVector Position;
+		Position[Face.Axis] = Slice + (Face.Direction > 0 ? 1 : 0);
+		Position[Face.U] = U + Face.Corners[i].X * Width;
+		Position[Face.V] = V + Face.Corners[i].Y * Height;
+
+		Out.Vertices.Add(Position * (Input.VoxelScale * Stride));
+		Out.Normals.Add(Normal);
+		Out.UVs.Add(FVector2D((i == 1 || i == 2) * FirstExtent, (i == 2 || i == 3) * SecondExtent));
+	}
+
+	Out.Triangles.Add(Start + 0);
+	Out.Triangles.Add(Start + 1);
+	Out.Triangles.Add(Start + 2);
+
+	Out.Triangles.Add(Start + 0);
+	Out.Triangles.Add(Start + 2);
+	Out.Triangles.Add(Start + 3);
+
+	Out.TriangleMaterials.Add(Material);
+	Out.TriangleMaterials.Add(Material);
+}
+
+void FChunkMesher::BuildGreedyCubes(FChunkMeshData& Out) const
+{
+	const int32 ChunkSizeXY = Input.ChunkSizeXY;
+	const int32 ChunkHeightZ = Input.ChunkHeightZ;
+
+	if (!Voxels.HasSameSize(ChunkSizeXY, ChunkHeightZ)) return;
+
+	FChunkSolidMask Solid;
+	BuildSolidMask(Solid);
+
+	const int32 Dims[3] = { CellsXY, CellsXY, CellsZ };
+
+	// Face key per cell of the current slice, 0 where there is no face or it was already merged
+	TArray<uint32> Mask;
+
+	for (int FaceIndex = 0; FaceIndex < 6; ++FaceIndex)
+	{
+		const FGreedyFace& Face = GreedyFaces[FaceIndex];
+		const int32 SizeU = Dims[Face.U];
+		const int32 SizeV = Dims[Face.V];
+
+		Mask.SetNumUninitialized(SizeU * SizeV);
+
+		for (int Slice = 0; Slice < Dims[Face.Axis]; ++Slice)
+		{
+			for (int v = 0; v < SizeV; v++)
+			{
+				for (int u = 0; u < SizeU; u++)
+				{
+					int32 P[3];
+					P[Face.Axis] = Slice;
+					P[Face.U] = u;
+					P[Face.V] = v;
+
+					Mask[u + v * SizeU] = GetGreedyFaceKey(FaceIndex, P[0], P[1], P[2], Solid);
+				}
+			}
+
+			// Grow each unmerged face along U, then along V while the whole row still matches
+			for (int v = 0; v < SizeV; v++)
+			{
+				for (int u = 0; u < SizeU; )
+				{
+					const uint32 Key = Mask[u + v * SizeU];
+
+					if (Key == 0)
+					{
+						u++;
+						continue;
+					}
+
+					int Width = 1;
+					while (u + Width < SizeU && Mask[u + Width + v * SizeU] == Key)
+					{
+						Width++;
+					}
+
+					int Height = 1;
+					for (; v + Height < SizeV; Height++)
+					{
+						const uint32* Row = &Mask[u + (v + Height) * SizeU];
+
+						int Run = 0;
+						while (Run < Width && Row[Run] == Key)
+						{
+							Run++;
+						}
+
+						if (Run < Width) break;
+					}
+
+					for (int dv = 0; dv < Height; dv++)
+					{
+						FMemory::Memzero(&Mask[u + (v + dv) * SizeU], Width * sizeof(uint32));
+					}
+
+					AddGreedyQuad(FaceIndex, Slice, u, v, Width, Height, (uint8)(Key - 1), Out);
+
+					u += Width;
+				}
+			}
+		}
+	}
+}
+
+void FChunkMesher::BuildMarchingCubes(FChunkMeshData& Out) const
+{
+	const float IsoLevel = 0.0f;
+
+	const int32 ChunkSizeXY = Input.ChunkSizeXY;
+	const int32 ChunkHeightZ = Input.ChunkHeightZ;
+	const float CellScale = Input.VoxelScale * Stride;
+
+	if (!Voxels.HasSameSize(ChunkSizeXY, ChunkHeightZ)) return;
+	if (Input.Columns.IsEmpty() && !Input.TerrainGenerator) return;
+
+	FChunkDensityGrid Density;
+	BuildDensityGrid(Density);
+
+	TArray<FVector>& Vertices = Out.Vertices;
+	TArray<int32>& Triangles = Out.Triangles;
+	TArray<FVector>& Normals = Out.Normals;
+	TArray<FVector2D>& UVs = Out.UVs;
+	TArray<uint8>& TriangleMaterials = Out.TriangleMaterials;
+
+	// Vertex indices for the edges starting on lattice planes x and x + 1, three per point (+X, +Y, +Z).
+	// A cell only touches those two planes, so once a plane is behind us its slab is recycled for the next.
+	const int32 SlabPointsY = CellsXY + 1;
+	const int32 SlabPointsZ = CellsZ + 1;
+	const int32 SlabSize = SlabPointsY * SlabPointsZ * 3;
+
+	TArray<int32> EdgeSlabs[2];
+	EdgeSlabs[0].Init(INDEX_NONE, SlabSize);
+	EdgeSlabs[1].Init(INDEX_NONE, SlabSize);
+
+	const int32 EstimatedCells = CellsXY * CellsXY * CellsZ;
+	Vertices.Reserve(EstimatedCells * 2);
+	Triangles.Reserve(EstimatedCells * 5);
+	Normals.Reserve(EstimatedCells * 2);
+	UVs.Reserve(EstimatedCells * 2);
+
+	for (int x = 0; x < CellsXY; x++)
+	{
+		int32* CurrentSlab = EdgeSlabs[x & 1].GetData();
+		int32* NextSlab = EdgeSlabs[(x + 1) & 1].GetData();
+
+		for (int y = 0; y < CellsXY; y++)
+		{
+			for (int z = 0; z < CellsZ; z++)
+			{
+				float val[8];
+				FVector pos[8];
+
+				// Positions are relative to the chunk actor, which sits at the chunk's first voxel. Lattice units are cells.
+				pos[0] = FVector(x, y, z) * CellScale;
+				pos[1] = FVector(x + 1, y, z) * CellScale;
+				pos[2] = FVector(x + 1, y + 1, z) * CellScale;
+				pos[3] = FVector(x, y + 1, z) * CellScale;
+				pos[4] = FVector(x, y, z + 1) * CellScale;
+				pos[5] = FVector(x + 1, y, z + 1) * CellScale;
+				pos[6] = FVector(x + 1, y + 1, z + 1) * CellScale;
+				pos[7] = FVector(x, y + 1, z + 1) * CellScale;
+
+				val[0] = Density.Get(x, y, z);
+				val[1] = Density.Get(x + 1, y, z);
+				val[2] = Density.Get(x + 1, y + 1, z);
+				val[3] = Density.Get(x, y + 1, z);
+				val[4] = Density.Get(x, y, z + 1);
+				val[5] = Density.Get(x + 1, y, z + 1);
+				val[6] = Density.Get(x + 1, y + 1, z + 1);
+				val[7] = Density.Get(x, y + 1, z + 1);
+
+				int cubeIndex = 0;
+
+				if (val[0] > IsoLevel) cubeIndex |= 1;
+				if (val[1] > IsoLevel) cubeIndex |= 2;
+				if (val[2] > IsoLevel) cubeIndex |= 4;
+				if (val[3] > IsoLevel) cubeIndex |= 8;
+				if (val[4] > IsoLevel) cubeIndex |= 16;
+				if (val[5] > IsoLevel) cubeIndex |= 32;
+				if (val[6] > IsoLevel) cubeIndex |= 64;
+				if (val[7] > IsoLevel) cubeIndex |= 128;
+
+				if (MarchingCubeTables::edgeTable[cubeIndex] == 0) continue;
+
+				// Welded vertex for a cell edge: looked up in the slab that owns the edge, interpolated on first use
+				auto GetOrCreateEdgeVertex = [&](int Edge) -> int32
+				{
+					const FCellEdge& CellEdge = CellEdges[Edge];
+					int32* Slab = CellEdge.DX ? NextSlab : CurrentSlab;
+					int32& Cached = Slab[((y + CellEdge.DY) + (z + CellEdge.DZ) * SlabPointsY) * 3 + CellEdge.Axis];
+
+					if (Cached != INDEX_NONE)
+					{
+						return Cached;
+					}
+
+					const float Mu = EdgeAlpha(IsoLevel, val[CellEdge.From], val[CellEdge.To]);
+					const FVector Vertex = pos[CellEdge.From] + Mu * (pos[CellEdge.To] - pos[CellEdge.From]);
+
+					// Density rises into the ground, so the surface normal points down its gradient. The gradient is
+					// taken at both ends of the edge from the density grid and blended like the position.
+					const FIntVector From = FIntVector(x, y, z) + CellCorners[CellEdge.From];
+					const FIntVector To = FIntVector(x, y, z) + CellCorners[CellEdge.To];
+					const FVector Gradient = FMath::Lerp(Density.Gradient(From.X, From.Y, From.Z), Density.Gradient(To.X, To.Y, To.Z), Mu);
+					const FVector Normal = (-Gradient).GetSafeNormal();
+
+					Cached = Vertices.Add(Vertex);
+					Normals.Add(Normal.IsNearlyZero() ? FVector::UpVector : Normal);
+					UVs.Add(FVector2D(Vertex.X / 1000.0f, Vertex.Y / 1000.0f));
+
+					return Cached;
+				};
+
+				const uint8 Material = GetCellMaterial(x, y, z, val, IsoLevel);
+
+				for (int i = 0; MarchingCubeTables::triTable[cubeIndex][i] != -1; i += 3)
+				{
+					int i0 = GetOrCreateEdgeVertex(MarchingCubeTables::triTable[cubeIndex][i]);
+					int i1 = GetOrCreateEdgeVertex(MarchingCubeTables::triTable[cubeIndex][i + 1]);
+					int i2 = GetOrCreateEdgeVertex(MarchingCubeTables::triTable[cubeIndex][i + 2]);
+
+					Triangles.Add(i0);
+					Triangles.Add(i1);
+					Triangles.Add(i2);
+					TriangleMaterials.Add(Material);
+				}
+			}
+		}
+
+		// Plane x is finished; its slab becomes plane x + 2
+		EdgeSlabs[x & 1].Init(INDEX_NONE, SlabSize);
+	}
+}
+
+void FChunkMesher::BuildDensityGrid(FChunkDensityGrid& Grid) const
+{
+	const int32 ChunkSizeXY = Input.ChunkSizeXY;
+	const int32 ChunkHeightZ = Input.ChunkHeightZ;
+	const int32 BaseX = Input.ChunkCoords.X * ChunkSizeXY;
+	const int32 BaseY = Input.ChunkCoords.Y * ChunkSizeXY;
+	const int32 BaseZ = Input.ChunkCoords.Z * ChunkHeightZ;
+
+	const int32 LayerSize = ChunkSizeXY * ChunkSizeXY;
+	const bool bHasBelow = Input.BorderDensityBelow.Num() == LayerSize;
+	const bool bHasAbove = Input.BorderDensityAbove.Num() == LayerSize * 2;
+
+	Grid.Init(CellsXY, CellsZ);
+
+	// Densities down the voxel column at local (lx, ly) for every lattice Z, written to OutValues[z + 1]. Cell
+	// coordinates are scaled to voxels (x, y, z to lx, ly, lz) before any lookup.
+	auto SampleColumn = [&](int32 lx, int32 ly, float* OutValues)
+	{
+		const bool bInside = lx >= 0 && lx < ChunkSizeXY && ly >= 0 && ly < ChunkSizeXY;
+
+		// Voxel densities for the chunk itself, or what the neighbour stored for a padding column
+		const float* BorderValues = nullptr;
+
+		if (!bInside)
+		{
+			const int32 Border = Input.BorderColumnIndex(lx, ly);
+			if (Input.BorderDensityValid.IsValidIndex(Border) && Input.BorderDensityValid[Border])
+			{
+				BorderValues = &Input.BorderDensity[Border * ChunkHeightZ];
+			}
+		}
+
+		// Wherever no voxels were captured, density follows the terrain height. It goes through the same
+		// quantization as stored voxels so seams match whichever side provides them.
+		const float Height = GetColumnHeight(BaseX + lx, BaseY + ly);
+		const int32 Column = lx + ly * ChunkSizeXY;
+
+		for (int32 z = -1; z <= CellsZ + 1; ++z)
+		{
+			const int32 lz = z * Stride;
+			const bool bInsideZ = lz >= 0 && lz < ChunkHeightZ;
+			float Value;
+
+			if (bInsideZ && bInside)
+			{
+				Value = Voxels.GetDensity(lx, ly, lz);
+			}
+			else if (bInsideZ && BorderValues)
+			{
+				Value = BorderValues[lz];
+			}
+			else if (bInside && lz == -1 && bHasBelow)
+			{
+				Value = Input.BorderDensityBelow[Column];
+			}
+			else if (bInside && (lz == ChunkHeightZ || lz == ChunkHeightZ + 1) && bHasAbove)
+			{
+				Value = Input.BorderDensityAbove[Column + (lz - ChunkHeightZ) * LayerSize];
+			}
+			else
+			{
+				Value = FVoxelStorage::StoredDensity(Height - (BaseZ + lz));
+			}
+
+			OutValues[z + 1] = Value;
+		}
+	};
+
+	const int32 NumZ = CellsZ + 3;
+	TArray<float> Samples;
+	Samples.SetNumUninitialized(NumZ * 2);
+
+	// The outer padding of a coarse lattice lies beyond the captured borders and column field; it is filled below
+	const int32 First = Stride > 1 ? 0 : -1;
+	const int32 Last = Stride > 1 ? CellsXY : CellsXY + 1;
+
+	for (int32 y = First; y <= Last; ++y)
+	{
+		for (int32 x = First; x <= Last; ++x)
+		{
+			SampleColumn(x * Stride, y * Stride, Samples.GetData());
+
+			for (int32 z = -1; z <= CellsZ + 1; ++z)
+			{
+				Grid.Values[Grid.Index(x, y, z)] = Samples[z + 1];
+			}
+		}
+	}
+
+	if (Stride == 1) return;
+
+	// The outer padding only feeds the normals on the chunk's edge. It is set so the central difference there is
+	// the difference across the voxels on either side of the edge, scaled to the stride. The neighbour reads the
+	// same two voxels for its edge, so both meshes get the same normal without evaluating any noise.
+	for (int32 Side = 0; Side < 4; ++Side)
+	{
+		const bool bAlongX = Side < 2;
+		const int32 Direction = (Side & 1) ? 1 : -1;
+		const int32 Edge = Direction < 0 ? 0 : CellsXY;
+		const int32 EdgeVoxel = Edge * Stride;
+
+		for (int32 t = 0; t <= CellsXY; ++t)
+		{
+			float* Low = Samples.GetData();
+			float* High = Samples.GetData() + NumZ;
+
+			if (bAlongX)
+			{
+				SampleColumn(EdgeVoxel - 1, t * Stride, Low);
+				SampleColumn(EdgeVoxel + 1, t * Stride, High);
+			}
+			else
+			{
+				SampleColumn(t * Stride, EdgeVoxel - 1, Low);
+				SampleColumn(t * Stride, EdgeVoxel + 1, High);
+			}
+
+			for (int32 z = -1; z <= CellsZ + 1; ++z)
+			{
+				const float Step = Direction * Stride * (High[z + 1] - Low[z + 1]);
+
+				if (bAlongX)
+				{
+					Grid.Values[Grid.Index(Edge + Direction, t, z)] = Grid.Get(Edge - Direction, t, z) + Step;
+				}
+				else
+				{
+					Grid.Values[Grid.Index(t, Edge + Direction, z)] = Grid.Get(t, Edge - Direction, z) + Step;
+				}
+			}
+		}
+	}
+
+	// Corners of the padding are never read; copy a neighbour so the grid holds no garbage
+	for (int32 CornerY : { -1, CellsXY + 1 })
+	{
+		for (int32 CornerX : { -1, CellsXY + 1 })
+		{
+			const int32 FromX = FMath::Clamp(CornerX, 0, CellsXY);
+
+			for (int32 z = -1; z <= CellsZ + 1; ++z)
+			{
+				Grid.Values[Grid.Index(CornerX, CornerY, z)] = Grid.Get(FromX, CornerY, z);
+			}
+		}
+	}
+}
+
+void FChunkMesher::AddSkirts(FChunkMeshData& Out) const
+{
+	const float ChunkExtent = CellsXY * (Input.VoxelScale * Stride);
+	const int32 NumTriangles = Out.Triangles.Num();
+
+	for (int32 Side = 0; Side < 4; ++Side)
+	{
+		if (!Input.HasLodSeam(Side)) continue;
+
+		// Same side order as BorderSolid: +X, -X, +Y, -Y
+		const int32 Axis = Side < 2 ? 0 : 1;
+		const float Plane = (Side % 2 == 0) ? ChunkExtent : 0.0f;
+		const FVector Drop(0.0f, 0.0f, FMath::Max(Stride, Input.NeighborLodStride[Side]) * Input.VoxelScale);
+
+		auto IsOnPlane = [&](int32 Vertex) { return FMath::IsNearlyEqual(Out.Vertices[Vertex][Axis], Plane, 0.01f); };
+
+		for (int32 t = 0; t < NumTriangles; t += 3)
+		{
+			for (int32 e = 0; e < 3; ++e)
+			{
+				const int32 A = Out.Triangles[t + e];
+				const int32 B = Out.Triangles[t + (e + 1) % 3];
+				if (!IsOnPlane(A) || !IsOnPlane(B)) continue;
+
+				// Copied out first: adding an element of the array being grown is not allowed, it may reallocate
+				for (const int32 Top : { A, B })
+				{
+					const FVector Normal = Out.Normals[Top];
+					const FVector2D UV = Out.UVs[Top];
+
+					Out.Vertices.Add(Out.Vertices[Top] - Drop);
+					Out.Normals.Add(Normal);
+					Out.UVs.Add(UV);
+				}
+
+				const int32 LowA = Out.Vertices.Num() - 2;
+				const int32 LowB = Out.Vertices.Num() - 1;
+
+				const int32 Quad[12] = { A, B, LowB, A, LowB, LowA, A, LowB, B, A, LowA, LowB };
+				Out.Triangles.Append(Quad, 12);
+
+				// The skirt continues the material of the triangle it hangs from
+				const uint8 Material = Out.TriangleMaterials[t / 3];
+				for (int32 i = 0; i < 4; ++i) Out.TriangleMaterials.Add(Material);
+			}
+		}
+	}
+}
+
+float FChunkMesher::GetColumnHeight(int GlobalX, int GlobalY) const
+{
+	if (Input.Columns.Contains(GlobalX, GlobalY))
+	{
+		return Input.Columns.GetHeight(GlobalX, GlobalY);
+	}
+
+	return Input.TerrainGenerator ? Input.TerrainGenerator->GetTerrainHeight(GlobalX, GlobalY) : 0.0f;
+}
+
+float FChunkMesher::EdgeAlpha(float IsoLevel, float ValP1, float ValP2) const
+{
+	if (FMath::Abs(IsoLevel - ValP1) < KINDA_SMALL_NUMBER)
+		return 0.0f;
+	if (FMath::Abs(IsoLevel - ValP2) < KINDA_SMALL_NUMBER)
+		return 1.0f;
+	if (FMath::Abs(ValP1 - ValP2) < KINDA_SMALL_NUMBER)
+		return 0.0f;
+	return (IsoLevel - ValP1) / (ValP2 - ValP1);
+}
+
+uint8 FChunkMesher::GetCellMaterial(int X, int Y, int Z, const float* CornerDensities, float IsoLevel) const
+{
+	// Top corners first
+	static const int32 CornerOrder[8] = { 4, 5, 6, 7, 0, 1, 2, 3 };
+
+	int32 Corner = 0;
+	for (int32 Candidate : CornerOrder)
+	{
+		if (CornerDensities[Candidate] > IsoLevel)
+		{
+			Corner = Candidate;
+			break;
+		}
+	}
+
+	const FIntVector Cell = (FIntVector(X, Y, Z) + CellCorners[Corner]) * Stride;
+
+	return Voxels.GetMaterial(
+		FMath::Clamp(Cell.X, 0, Input.ChunkSizeXY - 1),
+		FMath::Clamp(Cell.Y, 0, Input.ChunkSizeXY - 1),
+		FMath::Clamp(Cell.Z, 0, Input.ChunkHeightZ - 1));
+}
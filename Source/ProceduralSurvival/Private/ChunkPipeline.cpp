@@ -0,0 +1,147 @@
+#include "ChunkPipeline.h"
+#include "WorldChunk.h"
+
+FChunkPipeline::~FChunkPipeline()
+{
+	Shutdown();
+}
+
+void FChunkPipeline::Dispatch(const TSharedRef<FChunkBuildJob>& Job)
+{
+	Cancel(Job->ChunkCoords);
+	InFlight.Add(Job->ChunkCoords, Job);
+
+	// Forget tasks that already finished so the list only tracks live work
+	Tasks.RemoveAllSwap([](const UE::Tasks::FTask& Task) { return Task.IsCompleted(); });
+
+	TSharedPtr<FChunkBuildJob> SharedJob = Job;
+	Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, SharedJob]()
+	{
+		RunJob(*SharedJob);
+		Completed.Enqueue(SharedJob);
+	}));
+}
+
+void FChunkPipeline::Cancel(const FIntVector& ChunkCoords)
+{
+	TSharedPtr<FChunkBuildJob> Job;
+	if (InFlight.RemoveAndCopyValue(ChunkCoords, Job) && Job.IsValid())
+	{
+		Job->bCancelled.store(true, std::memory_order_relaxed);
+		++NumCancelled;
+	}
+}
+
+void FChunkPipeline::Shutdown()
+{
+	for (auto& Pair : InFlight)
+	{
+		Pair.Value->bCancelled.store(true, std::memory_order_relaxed);
+	}
+	InFlight.Reset();
+
+	UE::Tasks::Wait(Tasks);
+	Tasks.Reset();
+
+	TSharedPtr<FChunkBuildJob> Discarded;
+	while (Completed.Dequeue(Discarded))
+	{
+	}
+
+	NumCancelled = 0;
+}
+
+bool FChunkPipeline::PopCompleted(TSharedPtr<FChunkBuildJob>& OutJob)
+{
+	TSharedPtr<FChunkBuildJob> Job;
+	while (Completed.Dequeue(Job))
+	{
+		Retire(Job);
+
+		if (Job->IsCancelled()) continue;
+
+		OutJob = Job;
+		return true;
+	}
+
+	return false;
+}
+
+const FChunkBuildJob* FChunkPipeline::PeekCompleted()
+{
+	TSharedPtr<FChunkBuildJob> Job;
+	while (Completed.Peek(Job))
+	{
+		if (!Job->IsCancelled()) return Job.Get();
+
+		Completed.Pop();
+		Retire(Job);
+	}
+
+	return nullptr;
+}
+
+void FChunkPipeline::Retire(const TSharedPtr<FChunkBuildJob>& Job)
+{
+	// Cancel already took it out of InFlight, but it held a slot until now
+	if (Job->IsCancelled())
+	{
+		--NumCancelled;
+		return;
+	}
+
+	const TSharedPtr<FChunkBuildJob>* Current = InFlight.Find(Job->ChunkCoords);
+	if (Current && *Current == Job)
+	{
+		InFlight.Remove(Job->ChunkCoords);
+	}
+}
+
+void FChunkPipeline::RunJob(FChunkBuildJob& Job)
+{
+	if (Job.IsCancelled()) return;
+
+	FChunkMeshInput& Input = Job.MeshInput;
+
+	if (Job.Type == EChunkJobType::GenerateColumn)
+	{
+		const FIntPoint ColumnXY(Job.ChunkCoords.X, Job.ChunkCoords.Y);
+
+		// Saved columns only cost a read and a decompress; the noise runs for the rest
+		FChunkColumnRecord Record;
+		Job.bLoadedFromDisk = Job.RegionStore && Job.RegionStore->LoadColumn(ColumnXY, Record);
+
+		if (Job.IsCancelled()) return;
+
+		if (!Job.bLoadedFromDisk)
+		{
+			if (!Input.TerrainGenerator) return;
+
+			if (!AWorldChunk::GenerateColumnRecord(*Input.TerrainGenerator, ColumnXY, Input.ChunkSizeXY, Input.ChunkHeightZ, Record, &Job.bCancelled)) return;
+		}
+		else if (Input.TerrainGenerator)
+		{
+			// Region files keep heights and biomes only; the weight grid is a few dozen samples to rebuild
+			Input.TerrainGenerator->FillBiomeGrid(Record.Columns);
+		}
+
+		Job.MinSurfaceSection = Record.MinSurfaceSection;
+		Job.MaxSurfaceSection = Record.MaxSurfaceSection;
+		Job.Sections = MoveTemp(Record.Sections);
+		Input.Columns = MoveTemp(Record.Columns);
+		return;
+	}
+
+	if (Job.IsCancelled()) return;
+
+	if (Job.Type == EChunkJobType::FarFieldTile)
+	{
+		if (Input.TerrainGenerator)
+		{
+			AFarFieldTerrain::BuildTileMesh(*Input.TerrainGenerator, Job.FarFieldTile, Job.MeshData);
+		}
+		return;
+	}
+
+	FChunkMesher(Input, Job.Voxels).Build(Job.MeshData);
+}
@@ -0,0 +1,283 @@
+#include "FarFieldTerrain.h"
+#include "ProceduralMeshComponent.h"
+#include "TerrainGenerator.h"
+
+AFarFieldTerrain::AFarFieldTerrain()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Mesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("FarFieldMesh"));
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Mesh->SetCanEverAffectNavigation(false);
+	RootComponent = Mesh;
+}
+
+void AFarFieldTerrain::Configure(int32 InChunkSizeXY, float InVoxelScale, int32 InInnerRadius, int32 InOuterRadius)
+{
+	ChunkSizeXY = FMath::Max(1, InChunkSizeXY);
+	VoxelScale = InVoxelScale;
+	InnerRadius = FMath::Max(0, InInnerRadius);
+	OuterRadius = FMath::Max(InnerRadius, InOuterRadius);
+
+	for (const auto& Pair : TileSections)
+	{
+		FreeSections.Add(Pair.Value);
+	}
+
+	Mesh->ClearAllMeshSections();
+	TileSections.Reset();
+	Tiles.Reset();
+	PendingTiles.Reset();
+}
+
+bool AFarFieldTerrain::MakeTile(const FIntPoint& TileXY, FFarFieldTile& OutTile) const
+{
+	const FIntPoint FirstChunk = TileXY * TileChunks;
+	const FIntPoint LastChunk = FirstChunk + FIntPoint(TileChunks - 1, TileChunks - 1);
+
+	// The voxel terrain covers the chunks within InnerRadius of the center
+	const FIntPoint HoleMin(FMath::Max(FirstChunk.X, CenterChunk.X - InnerRadius), FMath::Max(FirstChunk.Y, CenterChunk.Y - InnerRadius));
+	const FIntPoint HoleMax(FMath::Min(LastChunk.X, CenterChunk.X + InnerRadius), FMath::Min(LastChunk.Y, CenterChunk.Y + InnerRadius));
+
+	OutTile = FFarFieldTile();
+
+	if (HoleMin.X <= HoleMax.X && HoleMin.Y <= HoleMax.Y)
+	{
+		if (HoleMin == FirstChunk && HoleMax == LastChunk) return false;
+
+		OutTile.HoleMin = HoleMin;
+		OutTile.HoleMax = HoleMax;
+	}
+
+	const FIntPoint CenterTile(FMath::FloorToInt((float)CenterChunk.X / TileChunks), FMath::FloorToInt((float)CenterChunk.Y / TileChunks));
+	const int32 Distance = FMath::Max(FMath::Abs(TileXY.X - CenterTile.X), FMath::Abs(TileXY.Y - CenterTile.Y));
+
+	OutTile.TileXY = TileXY;
+	OutTile.Origin = FirstChunk * ChunkSizeXY;
+	OutTile.SizeVoxels = TileChunks * ChunkSizeXY;
+	OutTile.ChunkSizeXY = ChunkSizeXY;
+	OutTile.VoxelScale = VoxelScale;
+
+	// Quads must not straddle a hole's edge, so tiles with a hole keep to steps that divide a chunk
+	const int32 Limit = OutTile.HasHole() ? ChunkSizeXY : OutTile.SizeVoxels;
+
+	int32 Step = FMath::Max(1, BaseStep) << FMath::Min(Distance / FMath::Max(1, StepRingTiles), 8);
+	Step = FMath::Min3(Step, MaxStep, Limit);
+
+	while (Step > 1 && (OutTile.SizeVoxels % Step != 0 || Limit % Step != 0))
+	{
+		--Step;
+	}
+
+	OutTile.Step = FMath::Max(1, Step);
+	return true;
+}
+
+void AFarFieldTerrain::SetCenter(const FIntPoint& InCenterChunk)
+{
+	CenterChunk = InCenterChunk;
+
+	const int32 MinTileX = FMath::FloorToInt((float)(CenterChunk.X - OuterRadius) / TileChunks);
+	const int32 MaxTileX = FMath::FloorToInt((float)(CenterChunk.X + OuterRadius) / TileChunks);
+	const int32 MinTileY = FMath::FloorToInt((float)(CenterChunk.Y - OuterRadius) / TileChunks);
+	const int32 MaxTileY = FMath::FloorToInt((float)(CenterChunk.Y + OuterRadius) / TileChunks);
+
+	TMap<FIntPoint, FFarFieldTile> NewTiles;
+
+	for (int32 TileY = MinTileY; TileY <= MaxTileY; ++TileY)
+	{
+		for (int32 TileX = MinTileX; TileX <= MaxTileX; ++TileX)
+		{
+			const FIntPoint TileXY(TileX, TileY);
+
+			FFarFieldTile Tile;
+			if (!MakeTile(TileXY, Tile)) continue;
+
+			// Most tiles keep their step and have no hole, so a move only rebuilds the rings whose sampling changed
+			const FFarFieldTile* Existing = Tiles.Find(TileXY);
+			if (!Existing || !Existing->IsSameBuild(Tile))
+			{
+				PendingTiles.Add(TileXY);
+			}
+
+			NewTiles.Add(TileXY, Tile);
+		}
+	}
+
+	for (const auto& Pair : Tiles)
+	{
+		if (!NewTiles.Contains(Pair.Key))
+		{
+			RemoveTileSection(Pair.Key);
+			PendingTiles.Remove(Pair.Key);
+		}
+	}
+
+	Tiles = MoveTemp(NewTiles);
+}
+
+bool AFarFieldTerrain::PopPendingTile(FFarFieldTile& OutTile)
+{
+	const FIntPoint CenterTile(FMath::FloorToInt((float)CenterChunk.X / TileChunks), FMath::FloorToInt((float)CenterChunk.Y / TileChunks));
+
+	const FIntPoint* Best = nullptr;
+	int32 BestDistance = MAX_int32;
+
+	for (const FIntPoint& TileXY : PendingTiles)
+	{
+		const int32 Distance = FMath::Max(FMath::Abs(TileXY.X - CenterTile.X), FMath::Abs(TileXY.Y - CenterTile.Y));
+		if (Distance < BestDistance)
+		{
+			Best = &TileXY;
+			BestDistance = Distance;
+		}
+	}
+
+	if (!Best) return false;
+
+	const FIntPoint TileXY = *Best;
+	PendingTiles.Remove(TileXY);
+
+	const FFarFieldTile* Tile = Tiles.Find(TileXY);
+	if (!Tile) return false;
+
+	OutTile = *Tile;
+	return true;
+}
+
+void AFarFieldTerrain::ApplyTileMesh(const FFarFieldTile& Tile, const FChunkMeshData& MeshData)
+{
+	const FFarFieldTile* Current = Tiles.Find(Tile.TileXY);
+	if (!Current || !Current->IsSameBuild(Tile)) return;
+
+	int32 Section;
+	if (const int32* Existing = TileSections.Find(Tile.TileXY))
+	{
+		Section = *Existing;
+	}
+	else
+	{
+		Section = FreeSections.Num() > 0 ? FreeSections.Pop(EAllowShrinking::No) : TileSections.Num();
+		TileSections.Add(Tile.TileXY, Section);
+	}
+
+	Mesh->CreateMeshSection(Section, MeshData.Vertices, MeshData.Triangles, MeshData.Normals, MeshData.UVs, MeshData.VertexColors, {}, false);
+
+	if (Material)
+	{
+		Mesh->SetMaterial(Section, Material);
+	}
+}
+
+void AFarFieldTerrain::RemoveTileSection(const FIntPoint& TileXY)
+{
+	int32 Section;
+	if (!TileSections.RemoveAndCopyValue(TileXY, Section)) return;
+
+	Mesh->ClearMeshSection(Section);
+	FreeSections.Add(Section);
+}
+
+void AFarFieldTerrain::BuildTileMesh(const UTerrainGenerator& TerrainGen, const FFarFieldTile& Tile, FChunkMeshData& Out)
+{
+	Out.Reset();
+
+	const int32 Step = Tile.Step;
+	const int32 NumQuads = Tile.SizeVoxels / Step;
+	if (NumQuads <= 0) return;
+
+	// One sample of padding on every side for the normals
+	const int32 NumSamples = NumQuads + 3;
+
+	TArray<float> Heights;
+	TArray<uint8> Biomes;
+	TerrainGen.GenerateColumnGrid(Tile.Origin.X - Step, Tile.Origin.Y - Step, Step, NumSamples, NumSamples, Heights, Biomes);
+
+	auto Sample = [&](int32 X, int32 Y) { return (X + 1) + (Y + 1) * NumSamples; };
+
+	const float Scale = Tile.VoxelScale;
+	const int32 NumVertices = NumQuads + 1;
+
+	Out.Vertices.Reserve(NumVertices * NumVertices);
+	Out.Normals.Reserve(NumVertices * NumVertices);
+	Out.UVs.Reserve(NumVertices * NumVertices);
+	Out.VertexColors.Reserve(NumVertices * NumVertices);
+
+	for (int32 Y = 0; Y < NumVertices; ++Y)
+	{
+		for (int32 X = 0; X < NumVertices; ++X)
+		{
+			const int32 Index = Sample(X, Y);
+			const FVector Position(Tile.Origin.X + X * Step, Tile.Origin.Y + Y * Step, Heights[Index]);
+
+			// Central differences over two steps, in voxel units on every axis
+			const FVector Normal(
+				(Heights[Sample(X - 1, Y)] - Heights[Sample(X + 1, Y)]) / (2.0f * Step),
+				(Heights[Sample(X, Y - 1)] - Heights[Sample(X, Y + 1)]) / (2.0f * Step),
+				1.0f);
+
+			Out.Vertices.Add(Position * Scale);
+			Out.Normals.Add(Normal.GetSafeNormal());
+			Out.UVs.Add(FVector2D(Position.X * Scale / 1000.0f, Position.Y * Scale / 1000.0f));
+			Out.VertexColors.Add(TerrainGen.GetBiomeTable().GetColor(Biomes[Index]));
+		}
+	}
+
+	// Quads covered by the voxel terrain are left out
+	auto IsQuadDrawn = [&](int32 X, int32 Y)
+	{
+		if (X < 0 || Y < 0 || X >= NumQuads || Y >= NumQuads) return false;
+		if (!Tile.HasHole()) return true;
+
+		const int32 ChunkX = FMath::FloorToInt((float)(Tile.Origin.X + X * Step) / Tile.ChunkSizeXY);
+		const int32 ChunkY = FMath::FloorToInt((float)(Tile.Origin.Y + Y * Step) / Tile.ChunkSizeXY);
+		return ChunkX < Tile.HoleMin.X || ChunkX > Tile.HoleMax.X || ChunkY < Tile.HoleMin.Y || ChunkY > Tile.HoleMax.Y;
+	};
+
+	auto Vertex = [&](int32 X, int32 Y) { return X + Y * NumVertices; };
+
+	// Skirts hang below every open edge, hiding cracks against tiles of another step and the voxel terrain
+	const FVector Drop(0.0f, 0.0f, 2.0f * Step * Scale);
+
+	auto AddSkirt = [&](int32 A, int32 B)
+	{
+		// Copied out first: adding an element of the array being grown is not allowed, it may reallocate
+		for (const int32 Top : { A, B })
+		{
+			const FVector Normal = Out.Normals[Top];
+			const FVector2D UV = Out.UVs[Top];
+			const FColor Color = Out.VertexColors[Top];
+
+			Out.Vertices.Add(Out.Vertices[Top] - Drop);
+			Out.Normals.Add(Normal);
+			Out.UVs.Add(UV);
+			Out.VertexColors.Add(Color);
+		}
+
+		const int32 LowA = Out.Vertices.Num() - 2;
+		const int32 LowB = Out.Vertices.Num() - 1;
+
+		const int32 Quad[12] = { A, B, LowB, A, LowB, LowA, A, LowB, B, A, LowA, LowB };
+		Out.Triangles.Append(Quad, 12);
+	};
+
+	for (int32 Y = 0; Y < NumQuads; ++Y)
+	{
+		for (int32 X = 0; X < NumQuads; ++X)
+		{
+			if (!IsQuadDrawn(X, Y)) continue;
+
+			// Same winding as the chunk meshes' top faces
+			const int32 Quad[6] = {
+				Vertex(X, Y), Vertex(X, Y + 1), Vertex(X + 1, Y + 1),
+				Vertex(X, Y), Vertex(X + 1, Y + 1), Vertex(X + 1, Y)
+			};
+			Out.Triangles.Append(Quad, 6);
+
+			if (!IsQuadDrawn(X - 1, Y)) AddSkirt(Vertex(X, Y), Vertex(X, Y + 1));
+			if (!IsQuadDrawn(X + 1, Y)) AddSkirt(Vertex(X + 1, Y), Vertex(X + 1, Y + 1));
+			if (!IsQuadDrawn(X, Y - 1)) AddSkirt(Vertex(X, Y), Vertex(X + 1, Y));
+			if (!IsQuadDrawn(X, Y + 1)) AddSkirt(Vertex(X, Y + 1), Vertex(X + 1, Y + 1));
+		}
+	}
+}
@@ -0,0 +1,301 @@
+#include "RegionStore.h"
+#include "HAL/PlatformFileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/ScopeRWLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace RegionStore
+{
+	constexpr uint32 Magic = 0x47525856; // "VXRG"
+	// 2: voxels carry generated materials
+	// 3: heights interpolate biome weights over BiomeGridStep, so older columns don't meet regenerated ones
+	constexpr uint32 Version = 3;
+
+	// Magic, version and the two chunk sizes, then one entry per column
+	constexpr int64 HeaderBytes = 16;
+	constexpr int64 EntryBytes = 16;
+
+	// Sanity limit for section counts read back from disk
+	constexpr int32 MaxSectionsPerColumn = 4096;
+}
+
+FRegionStore::FRegionStore(const FString& InDirectory, int32 InChunkSizeXY, int32 InChunkHeightZ)
+	: Directory(InDirectory)
+	, ChunkSizeXY(InChunkSizeXY)
+	, ChunkHeightZ(InChunkHeightZ)
+{
+}
+
+FRegionStore::~FRegionStore()
+{
+	Flush();
+}
+
+FIntPoint FRegionStore::GetRegionCoords(const FIntPoint& ColumnXY)
+{
+	return FIntPoint(FMath::DivideAndRoundDown(ColumnXY.X, RegionSize), FMath::DivideAndRoundDown(ColumnXY.Y, RegionSize));
+}
+
+int32 FRegionStore::GetEntryIndex(const FIntPoint& ColumnXY)
+{
+	const FIntPoint Local = ColumnXY - GetRegionCoords(ColumnXY) * RegionSize;
+	return Local.X + Local.Y * RegionSize;
+}
+
+FString FRegionStore::GetRegionPath(const FIntPoint& RegionXY) const
+{
+	return FPaths::Combine(Directory, FString::Printf(TEXT("r.%d.%d.region"), RegionXY.X, RegionXY.Y));
+}
+
+FRegionStore::FRegion& FRegionStore::FindOrReadRegion(const FIntPoint& RegionXY)
+{
+	TUniquePtr<FRegion>& Region = Regions.FindOrAdd(RegionXY);
+	if (Region) return *Region;
+
+	Region = MakeUnique<FRegion>();
+	Region->Entries.SetNum(RegionSize * RegionSize);
+
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*GetRegionPath(RegionXY)));
+	if (!File) return *Region;
+
+	TArray<uint8> Header;
+	Header.SetNumUninitialized(RegionStore::HeaderBytes + RegionStore::EntryBytes * Region->Entries.Num());
+	if (!File->Read(Header.GetData(), Header.Num())) return *Region;
+
+	FMemoryReader Reader(Header);
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	int32 FileChunkSizeXY = 0;
+	int32 FileChunkHeightZ = 0;
+	Reader << FileMagic << FileVersion << FileChunkSizeXY << FileChunkHeightZ;
+
+	if (FileMagic != RegionStore::Magic || FileVersion != RegionStore::Version || FileChunkSizeXY != ChunkSizeXY || FileChunkHeightZ != ChunkHeightZ)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("RegionStore: ignoring %s, it was written for different settings"), *GetRegionPath(RegionXY));
+		return *Region;
+	}
+
+	for (FRegionEntry& Entry : Region->Entries)
+	{
+		SerializeEntry(Reader, Entry);
+	}
+
+	Region->bFileValid = !Reader.IsError();
+	return *Region;
+}
+
+const uint8* FRegionStore::MapEntry(const FIntPoint& RegionXY, FRegion& Region, const FRegionEntry& Entry)
+{
+	if (!Region.MappedView)
+	{
+		Region.MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*GetRegionPath(RegionXY)));
+		if (!Region.MappedFile) return nullptr;
+
+		Region.MappedView.Reset(Region.MappedFile->MapRegion(0, Region.MappedFile->GetFileSize()));
+		if (!Region.MappedView) return nullptr;
+	}
+
+	// Mappings are made after the last write to the file, so every entry in the table lies inside
+	if (Entry.Offset + Entry.CompressedSize > Region.MappedView->GetMappedSize()) return nullptr;
+
+	return Region.MappedView->GetMappedPtr() + Entry.Offset;
+}
+
+bool FRegionStore::LoadColumn(const FIntPoint& ColumnXY, FChunkColumnRecord& OutRecord)
+{
+	FReadScopeLock MappingScope(MappingLock);
+
+	FRegionEntry Entry;
+	const uint8* Compressed = nullptr;
+	TArray<uint8> ReadBuffer;
+
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		if (const TSharedPtr<FChunkColumnRecord>* Queued = Pending.Find(ColumnXY))
+		{
+			OutRecord = **Queued;
+			return true;
+		}
+
+		const FIntPoint RegionXY = GetRegionCoords(ColumnXY);
+		FRegion& Region = FindOrReadRegion(RegionXY);
+		if (!Region.bFileValid) return false;
+
+		Entry = Region.Entries[GetEntryIndex(ColumnXY)];
+		if (Entry.CompressedSize <= 0 || Entry.UncompressedSize <= 0) return false;
+
+		if (ReadMode == ERegionReadMode::Mapped)
+		{
+			Compressed = MapEntry(RegionXY, Region, Entry);
+		}
+
+		if (!Compressed)
+		{
+			TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*GetRegionPath(RegionXY)));
+			ReadBuffer.SetNumUninitialized(Entry.CompressedSize);
+
+			if (!File || !File->Seek(Entry.Offset) || !File->Read(ReadBuffer.GetData(), ReadBuffer.Num())) return false;
+
+			Compressed = ReadBuffer.GetData();
+		}
+	}
+
+	// Decompressing and decoding only need the shared mapping lock, so loads on several workers overlap here
+	TArray<uint8> Data;
+	Data.SetNumUninitialized(Entry.UncompressedSize);
+
+	if (!FCompression::UncompressMemory(NAME_LZ4, Data.GetData(), Data.Num(), Compressed, Entry.CompressedSize))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("RegionStore: failed to decompress column {%d,%d}"), ColumnXY.X, ColumnXY.Y);
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	SerializeRecord(Reader, OutRecord);
+
+	return !Reader.IsError();
+}
+
+void FRegionStore::SaveColumn(const FIntPoint& ColumnXY, FChunkColumnRecord&& Record)
+{
+	TSharedPtr<FChunkColumnRecord> Queued = MakeShared<FChunkColumnRecord>(MoveTemp(Record));
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		Pending.Add(ColumnXY, Queued);
+	}
+
+	WritePipe.Launch(UE_SOURCE_LOCATION, [this, ColumnXY, Queued]()
+	{
+		WriteColumn(ColumnXY, Queued);
+	});
+}
+
+void FRegionStore::Flush()
+{
+	WritePipe.WaitUntilEmpty();
+}
+
+void FRegionStore::WriteColumn(const FIntPoint& ColumnXY, const TSharedPtr<FChunkColumnRecord>& Record)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	SerializeRecord(Writer, *Record);
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_LZ4, Data.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+
+	const bool bCompressed = FCompression::CompressMemory(NAME_LZ4, Compressed.GetData(), CompressedSize, Data.GetData(), Data.Num());
+
+	FWriteScopeLock MappingScope(MappingLock);
+	FScopeLock ScopeLock(&Lock);
+
+	if (bCompressed)
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		const FIntPoint RegionXY = GetRegionCoords(ColumnXY);
+		const FString Path = GetRegionPath(RegionXY);
+		FRegion& Region = FindOrReadRegion(RegionXY);
+
+		// No mapping may be open while the file changes; the next load maps it again
+		Region.MappedView.Reset();
+		Region.MappedFile.Reset();
+
+		// Missing or unusable files start over with an empty table
+		if (!Region.bFileValid)
+		{
+			Region.Entries.Init(FRegionEntry(), RegionSize * RegionSize);
+
+			TArray<uint8> Header;
+			FMemoryWriter HeaderWriter(Header);
+			uint32 FileMagic = RegionStore::Magic;
+			uint32 FileVersion = RegionStore::Version;
+			HeaderWriter << FileMagic << FileVersion << ChunkSizeXY << ChunkHeightZ;
+
+			for (FRegionEntry& Entry : Region.Entries)
+			{
+				SerializeEntry(HeaderWriter, Entry);
+			}
+
+			PlatformFile.CreateDirectoryTree(*Directory);
+			Region.bFileValid = FFileHelper::SaveArrayToFile(Header, *Path);
+		}
+
+		TUniquePtr<IFileHandle> File(Region.bFileValid ? PlatformFile.OpenWrite(*Path, true, true) : nullptr);
+
+		// The record goes in first; the table entry is only repointed once it is complete
+		FRegionEntry Entry;
+		Entry.Offset = File ? File->Size() : 0;
+		Entry.CompressedSize = CompressedSize;
+		Entry.UncompressedSize = Data.Num();
+
+		TArray<uint8> EntryData;
+		FMemoryWriter EntryWriter(EntryData);
+		SerializeEntry(EntryWriter, Entry);
+
+		const int32 Index = GetEntryIndex(ColumnXY);
+
+		if (File &&
+			File->Seek(Entry.Offset) && File->Write(Compressed.GetData(), CompressedSize) &&
+			File->Seek(RegionStore::HeaderBytes + RegionStore::EntryBytes * Index) && File->Write(EntryData.GetData(), EntryData.Num()))
+		{
+			Region.Entries[Index] = Entry;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("RegionStore: failed to write column {%d,%d} to %s"), ColumnXY.X, ColumnXY.Y, *Path);
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("RegionStore: failed to compress column {%d,%d}"), ColumnXY.X, ColumnXY.Y);
+	}
+
+	// A newer save of the same column may have been queued meanwhile; that one stays pending
+	const TSharedPtr<FChunkColumnRecord>* Queued = Pending.Find(ColumnXY);
+	if (Queued && *Queued == Record)
+	{
+		Pending.Remove(ColumnXY);
+	}
+}
+
+void FRegionStore::SerializeEntry(FArchive& Ar, FRegionEntry& Entry)
+{
+	Ar << Entry.Offset << Entry.CompressedSize << Entry.UncompressedSize;
+}
+
+void FRegionStore::SerializeRecord(FArchive& Ar, FChunkColumnRecord& Record)
+{
+	FTerrainColumnField& Columns = Record.Columns;
+
+	Ar << Record.MinSurfaceSection << Record.MaxSurfaceSection;
+	Ar << Columns.Origin << Columns.Size << Columns.Heights << Columns.Biomes;
+
+	int32 NumSections = Record.Sections.Num();
+	Ar << NumSections;
+
+	if (Ar.IsLoading())
+	{
+		const int32 NumColumns = Columns.Size.X * Columns.Size.Y;
+
+		if (Columns.Heights.Num() != NumColumns || Columns.Biomes.Num() != NumColumns || NumSections < 0 || NumSections > RegionStore::MaxSectionsPerColumn)
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Record.Sections.SetNum(NumSections);
+	}
+
+	for (FChunkSectionVoxels& Section : Record.Sections)
+	{
+		Ar << Section.SectionZ << Section.Voxels;
+	}
+}
@@ -3,93 +3,124 @@
 
 #include "TerrainGenerator.h"
 
-FBiomeWeights UTerrainGenerator::GetBiomeWeights(float X, float Y) const
+FBiomeWeights FBiomeWeightGrid::Sample(float X, float Y) const
 {
-	float bx = X / BiomeScale;
-	float by = Y / BiomeScale;
-
-	float warp = FMath::PerlinNoise2D(FVector2D(bx * 0.5f, by * 0.5f)) * 0.15f;
+	int32 NodeX, NodeY;
+	float AlphaX, AlphaY;
+	Locate(X, Step, NodeX, AlphaX);
+	Locate(Y, Step, NodeY, AlphaY);
+
+	const int32 X0 = NodeX - Origin.X;
+	const int32 Y0 = NodeY - Origin.Y;
+	const int32 X1 = AlphaX != 0.0f ? X0 + 1 : X0;
+	const int32 Y1 = AlphaY != 0.0f ? Y0 + 1 : Y0;
+
+	return FBiomeWeights::Bilinear(
+		Weights[X0 + Y0 * Size.X], Weights[X1 + Y0 * Size.X],
+		Weights[X0 + Y1 * Size.X], Weights[X1 + Y1 * Size.X],
+		AlphaX, AlphaY);
+}
 
-	bx += warp;
-	by += warp;
-	
-	float v = FMath::PerlinNoise2D(FVector2D(bx, by));
+void UTerrainGenerator::SetSeed(int32 InSeed)
+{
+	Seed = InSeed;
+	Noise.SetSeed(Seed);
+}
 
-	float t = (v + 1.0f) * 0.5f;
+void UTerrainGenerator::PostInitProperties()
+{
+	Super::PostInitProperties();
+	Noise.SetSeed(Seed);
+	BiomeTable.Compile(Biomes);
+}
 
-	float PlainsEdge = 0.33f;
-	float MountainsEdge = 0.66f;
-	float BlendWidth = 0.1f;
+void UTerrainGenerator::PostLoad()
+{
+	Super::PostLoad();
+	Noise.SetSeed(Seed);
+	BiomeTable.Compile(Biomes);
+}
 
-	FBiomeWeights Weights;
+#if WITH_EDITOR
+void UTerrainGenerator::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	Noise.SetSeed(Seed);
+	BiomeTable.Compile(Biomes);
+}
+#endif
 
-	Weights.Plains = 1.0f - FMath::SmoothStep(PlainsEdge - BlendWidth, PlainsEdge + BlendWidth, t);
-	Weights.Plains *= 1.1f;
+void UTerrainGenerator::SetBiomes(const TArray<UBiomeDefinition*>& InBiomes)
+{
+	Biomes = InBiomes;
+	BiomeTable.Compile(Biomes);
+}
 
-	Weights.Mountains = FMath::SmoothStep(MountainsEdge - BlendWidth, MountainsEdge + BlendWidth, t);
+FBiomeWeights UTerrainGenerator::GetBiomeWeights(float X, float Y) const
+{
+	const int32 Step = GetBiomeGridStep();
 
-	Weights.Hills = 1.0f - Weights.Plains - Weights.Mountains;
-	Weights.Hills = FMath::Clamp(Weights.Hills, 0.0f, 1.0f);
+	int32 NodeX, NodeY;
+	float AlphaX, AlphaY;
+	FBiomeWeightGrid::Locate(X, Step, NodeX, AlphaX);
+	FBiomeWeightGrid::Locate(Y, Step, NodeY, AlphaY);
 
-	float sum = Weights.Plains + Weights.Hills + Weights.Mountains;
+	// Columns on a node need only that node; the others read the same nodes a batched grid would
+	const FBiomeWeights W00 = GetBiomeNodeWeights(NodeX, NodeY);
+	if (AlphaX == 0.0f && AlphaY == 0.0f) return W00;
 
-	if (sum > 0.0f)
-	{
-		Weights.Plains /= sum;
-		Weights.Hills /= sum;
-		Weights.Mountains /= sum;
-	}
+	const FBiomeWeights W10 = AlphaX != 0.0f ? GetBiomeNodeWeights(NodeX + 1, NodeY) : W00;
+	const FBiomeWeights W01 = AlphaY != 0.0f ? GetBiomeNodeWeights(NodeX, NodeY + 1) : W00;
+	const FBiomeWeights W11 = AlphaX != 0.0f && AlphaY != 0.0f ? GetBiomeNodeWeights(NodeX + 1, NodeY + 1) : (AlphaX != 0.0f ? W10 : W01);
 
-	return Weights;
+	return FBiomeWeights::Bilinear(W00, W10, W01, W11, AlphaX, AlphaY);
 }
 
-float UTerrainGenerator::GetPlainsHeight(int X, int Y) const
+FBiomeWeights UTerrainGenerator::GetBiomeNodeWeights(int32 NodeX, int32 NodeY) const
 {
-	float nx = X * PlainsFrequency;
-	float ny = Y * PlainsFrequency;
+	const int32 Step = GetBiomeGridStep();
 
-	float n = 
-		0.7f * FMath::PerlinNoise2D(FVector2D(nx, ny)) +
-		0.2f * FMath::PerlinNoise2D(FVector2D(2 * nx, 2 * ny));
+	float bx = (float)(NodeX * Step) / BiomeScale;
+	float by = (float)(NodeY * Step) / BiomeScale;
 
-	return n * PlainsAmplitude + PlainsBaseHeight;
-}
+	float warp = Noise.Perlin2D(bx * 0.5f, by * 0.5f) * 0.15f;
 
-float UTerrainGenerator::GetHillsHeight(int X, int Y) const
-{
-	float nx = X * HillsFrequency;
-	float ny = Y * HillsFrequency;
-
-	float n = 
-		0.6f * FMath::PerlinNoise2D(FVector2D(nx, ny)) +
-		0.3f * FMath::PerlinNoise2D(FVector2D(2 * nx, 2 * ny)) +
-		0.1f * FMath::PerlinNoise2D(FVector2D(4 * nx, 4 * ny));
+	bx += warp;
+	by += warp;
 
-	return n * HillsAmplitude + 25.0f;
+	return BiomeTable.WeightsFromNoise(Noise.Perlin2D(bx, by));
 }
 
-float UTerrainGenerator::GetMountainsHeight(int X, int Y) const
+float UTerrainGenerator::GetBiomeHeight(int32 Biome, int X, int Y) const
 {
-	float nx = X * MountainsFrequency;
-	float ny = Y * MountainsFrequency;
-
-	float r = 1.0f - FMath::Abs(FMath::PerlinNoise2D(FVector2D(nx, ny)));
+	const FBiomeTable::FEntry& Entry = BiomeTable.Entries[Biome];
 
-	r = r * r;
+	float nx = X * Entry.Frequency;
+	float ny = Y * Entry.Frequency;
 
-	float r2 = 1.0f - FMath::Abs(FMath::PerlinNoise2D(FVector2D(2 * nx, 2 * ny)));
-	r2 = r2 * r2 * 0.5f;
+	// Octaves double the frequency: nx, 2 * nx, 4 * nx, ... exactly as the batched path scales its axes
+	float Octaves[FBiomeTable::MaxOctaves];
+	float Scale = 1.0f;
 
-	float height = (r + r2) * MountainsAmplitude + 40.0f;
+	for (int32 Octave = 0; Octave < Entry.NumOctaves; Octave++)
+	{
+		Octaves[Octave] = Noise.Perlin2D(Scale * nx, Scale * ny);
+		Scale *= 2.0f;
+	}
 
-	return height;
+	return BiomeTable.HeightFromOctaves(Biome, Octaves);
 }
 
 float UTerrainGenerator::ApplyRivers(float X, float Y, float Height) const
 {
 	if (!EnableRivers) return Height;
 
-	float RiverValue = FMath::Abs(FMath::PerlinNoise2D(FVector2D(X, Y) * RiverFrequency));
+	return ApplyRiverNoise(Noise.Perlin2D(X * RiverFrequency, Y * RiverFrequency), Height);
+}
+
+float UTerrainGenerator::ApplyRiverNoise(float RiverNoise, float Height) const
+{
+	float RiverValue = FMath::Abs(RiverNoise);
 
 	if (RiverValue < RiverWidth)
 	{
@@ -104,59 +135,56 @@ float UTerrainGenerator::ApplyRivers(float X, float Y, float Height) const
 	return Height;
 }
 
-void UTerrainGenerator::PickDominantBiomes(const FBiomeWeights& Weights, EBiomeType& OutBiome1, EBiomeType& OutBiome2, float& OutBlend) const
+void UTerrainGenerator::PickDominantBiomes(const FBiomeWeights& Weights, uint8& OutBiome1, uint8& OutBiome2, float& OutBlend) const
 {
-	struct FBiomeWeightPair
-	{
-		EBiomeType Biome;
-		float Weight;
-	};
-
-	TArray<FBiomeWeightPair> BiomeWeightPairs;
-	BiomeWeightPairs.Add({ EBiomeType::Plains, Weights.Plains });
-	BiomeWeightPairs.Add({ EBiomeType::Hills, Weights.Hills });
-	BiomeWeightPairs.Add({ EBiomeType::Mountains, Weights.Mountains });
+	// The two heaviest in one pass. Ties go to the earlier biome, like a stable sort would.
+	int32 First = 0;
+	int32 Second = INDEX_NONE;
 
-	BiomeWeightPairs.Sort([](const FBiomeWeightPair& A, const FBiomeWeightPair& B)
+	for (int32 i = 1; i < Weights.Num; i++)
 	{
-		return A.Weight > B.Weight;
-	});
+		if (Weights.Weights[i] > Weights.Weights[First])
+		{
+			Second = First;
+			First = i;
+		}
+		else if (Second == INDEX_NONE || Weights.Weights[i] > Weights.Weights[Second])
+		{
+			Second = i;
+		}
+	}
+
+	// A single biome blends with itself at zero weight
+	if (Second == INDEX_NONE) Second = First;
 
-	OutBiome1 = BiomeWeightPairs[0].Biome;
-	OutBiome2 = BiomeWeightPairs[1].Biome;
-	OutBlend = BiomeWeightPairs[1].Weight;
+	OutBiome1 = (uint8)First;
+	OutBiome2 = (uint8)Second;
+	OutBlend = Second != First ? Weights.Weights[Second] : 0.0f;
 }
 
 float UTerrainGenerator::GetTerrainHeight(float X, float Y) const
 {
-	float continents = FMath::PerlinNoise2D(FVector2D(X, Y) * ContinentFrequency);
+	uint8 PrimaryBiome;
+	return GetTerrainHeightAndBiome(X, Y, PrimaryBiome);
+}
+
+float UTerrainGenerator::GetTerrainHeightAndBiome(float X, float Y, uint8& OutBiome) const
+{
+	float continents = Noise.Perlin2D(X * ContinentFrequency, Y * ContinentFrequency);
 	continents = continents * ContinentAmplitude + ContinentBaseHeight;
 
 	FBiomeWeights Weight = GetBiomeWeights(X, Y);
 
-	EBiomeType PrimaryBiome;
-	EBiomeType SecondaryBiome;
+	uint8 PrimaryBiome;
+	uint8 SecondaryBiome;
 
 	float Blend;
 	PickDominantBiomes(Weight, PrimaryBiome, SecondaryBiome, Blend);
+	OutBiome = PrimaryBiome;
 
-	auto getBiomeHeight = [&](EBiomeType Biome) -> float
-	{
-		switch (Biome)
-		{
-			case EBiomeType::Plains:
-				return GetPlainsHeight(X, Y);
-			case EBiomeType::Hills:
-				return GetHillsHeight(X, Y);
-			case EBiomeType::Mountains:
-				return GetMountainsHeight(X, Y);
-			default:
-				return 0.0f;
-		}
-	};
-
-	float h0 = getBiomeHeight(PrimaryBiome);
-	float h1 = getBiomeHeight(SecondaryBiome);
+	// Only the two blended biomes are evaluated, however many the table holds
+	float h0 = GetBiomeHeight(PrimaryBiome, X, Y);
+	float h1 = Blend != 0.0f ? GetBiomeHeight(SecondaryBiome, X, Y) : h0;
 
 	float biomeHeight = FMath::Lerp(h0, h1, Blend);
 
@@ -164,9 +192,9 @@ float UTerrainGenerator::GetTerrainHeight(float X, float Y) const
 
 	Height = ApplyRivers(X, Y, Height);
 
-	float surfaceNoise = FMath::PerlinNoise2D(FVector2D(X, Y) * 0.1f) * SurfaceNoiseAmplitude;
+	float surfaceNoise = Noise.Perlin2D(X * 0.1f, Y * 0.1f) * SurfaceNoiseAmplitude;
 	Height += surfaceNoise;
-	
+
 	return Height;
 }
 
@@ -176,15 +204,311 @@ float UTerrainGenerator::GetDensity(float X, float Y, float Z) const
 	return Height - Z;
 }
 
-EBiomeType UTerrainGenerator::GetDominantBiome(float X, float Y) const
+uint8 UTerrainGenerator::GetDominantBiome(float X, float Y) const
 {
 	const FBiomeWeights Weights = GetBiomeWeights(X, Y);
 
-	EBiomeType PrimaryBiome;
-	EBiomeType SecondaryBiome;
+	uint8 PrimaryBiome;
+	uint8 SecondaryBiome;
 
 	float blend = 0.0f;
 	PickDominantBiomes(Weights, PrimaryBiome, SecondaryBiome, blend);
 	return PrimaryBiome;
 }
 
+void UTerrainGenerator::GenerateColumnField(int32 OriginX, int32 OriginY, int32 SizeX, int32 SizeY, FTerrainColumnField& OutField) const
+{
+	OutField.Origin = FIntPoint(OriginX, OriginY);
+	OutField.Size = FIntPoint(FMath::Max(0, SizeX), FMath::Max(0, SizeY));
+
+	GenerateColumnGrid(OriginX, OriginY, 1, SizeX, SizeY, OutField.Heights, OutField.Biomes, &OutField.BiomeWeights);
+}
+
+void UTerrainGenerator::GenerateBiomeGrid(int32 MinX, int32 MinY, int32 MaxX, int32 MaxY, FBiomeWeightGrid& OutGrid) const
+{
+	const int32 Step = GetBiomeGridStep();
+
+	OutGrid.Step = Step;
+	OutGrid.Weights.Reset();
+
+	if (MaxX < MinX || MaxY < MinY)
+	{
+		OutGrid.Size = FIntPoint::ZeroValue;
+		return;
+	}
+
+	// The last column only needs the node after it when it sits between two nodes
+	auto NodeRange = [Step](int32 Min, int32 Max, TArray<int32>& OutNodes)
+	{
+		int32 First, Last;
+		float Alpha;
+		FBiomeWeightGrid::Locate((float)Min, Step, First, Alpha);
+		FBiomeWeightGrid::Locate((float)Max, Step, Last, Alpha);
+		if (Alpha != 0.0f) Last++;
+
+		OutNodes.SetNumUninitialized(Last - First + 1);
+		for (int32 i = 0; i < OutNodes.Num(); i++) OutNodes[i] = First + i;
+	};
+
+	TArray<int32> NodesX;
+	TArray<int32> NodesY;
+	NodeRange(MinX, MaxX, NodesX);
+	NodeRange(MinY, MaxY, NodesY);
+
+	OutGrid.Origin = FIntPoint(NodesX[0], NodesY[0]);
+	OutGrid.Size = FIntPoint(NodesX.Num(), NodesY.Num());
+	OutGrid.Weights.SetNumUninitialized(NodesX.Num() * NodesY.Num());
+	EvaluateBiomeNodes(NodesX.GetData(), NodesX.Num(), NodesY.GetData(), NodesY.Num(), OutGrid.Weights.GetData());
+}
+
+void UTerrainGenerator::FillBiomeGrid(FTerrainColumnField& Field) const
+{
+	GenerateBiomeGrid(Field.Origin.X, Field.Origin.Y, Field.Origin.X + Field.Size.X - 1, Field.Origin.Y + Field.Size.Y - 1, Field.BiomeWeights);
+}
+
+void UTerrainGenerator::EvaluateBiomeNodes(const int32* NodesX, int32 NumX, const int32* NodesY, int32 NumY, FBiomeWeights* OutWeights) const
+{
+	const int32 Step = GetBiomeGridStep();
+	const int32 Num = NumX * NumY;
+
+	if (Num == 0) return;
+
+	// A warp grid, then the warped lookups which no longer form a grid. Same float operations as GetBiomeNodeWeights.
+	TArray<float> BiomeX;
+	TArray<float> BiomeY;
+	BiomeX.SetNumUninitialized(NumX);
+	BiomeY.SetNumUninitialized(NumY);
+	for (int32 x = 0; x < NumX; x++) BiomeX[x] = (float)(NodesX[x] * Step) / BiomeScale;
+	for (int32 y = 0; y < NumY; y++) BiomeY[y] = (float)(NodesY[y] * Step) / BiomeScale;
+
+	TArray<float> AxisX;
+	TArray<float> AxisY;
+	AxisX.SetNumUninitialized(NumX);
+	AxisY.SetNumUninitialized(NumY);
+	for (int32 x = 0; x < NumX; x++) AxisX[x] = BiomeX[x] * 0.5f;
+	for (int32 y = 0; y < NumY; y++) AxisY[y] = BiomeY[y] * 0.5f;
+
+	TArray<float> Warp;
+	Warp.SetNumUninitialized(Num);
+	Noise.Perlin2DGrid(AxisX.GetData(), NumX, AxisY.GetData(), NumY, Warp.GetData());
+
+	TArray<float> WarpedX;
+	TArray<float> WarpedY;
+	WarpedX.SetNumUninitialized(Num);
+	WarpedY.SetNumUninitialized(Num);
+
+	for (int32 y = 0; y < NumY; y++)
+	{
+		for (int32 x = 0; x < NumX; x++)
+		{
+			const int32 Index = x + y * NumX;
+			const float warp = Warp[Index] * 0.15f;
+			WarpedX[Index] = BiomeX[x] + warp;
+			WarpedY[Index] = BiomeY[y] + warp;
+		}
+	}
+
+	TArray<float> BiomeNoise;
+	BiomeNoise.SetNumUninitialized(Num);
+	Noise.Perlin2DPoints(WarpedX.GetData(), WarpedY.GetData(), Num, BiomeNoise.GetData());
+
+	for (int32 i = 0; i < Num; i++)
+	{
+		OutWeights[i] = BiomeTable.WeightsFromNoise(BiomeNoise[i]);
+	}
+}
+
+void UTerrainGenerator::GenerateColumnGrid(int32 OriginX, int32 OriginY, int32 Step, int32 SizeX, int32 SizeY, TArray<float>& OutHeights, TArray<uint8>& OutBiomes, FBiomeWeightGrid* OutBiomeGrid) const
+{
+	const int32 NX = FMath::Max(0, SizeX);
+	const int32 NY = FMath::Max(0, SizeY);
+	const int32 Num = NX * NY;
+
+	OutHeights.SetNumUninitialized(Num);
+	OutBiomes.SetNumUninitialized(Num);
+
+	if (OutBiomeGrid) *OutBiomeGrid = FBiomeWeightGrid();
+
+	if (Num == 0) return;
+
+	// Per-axis sample coordinates, computed with the same float operations as the per-sample path
+	TArray<float> AxisX;
+	TArray<float> AxisY;
+	AxisX.SetNumUninitialized(NX);
+	AxisY.SetNumUninitialized(NY);
+
+	auto FillAxes = [&](float Scale)
+	{
+		for (int32 x = 0; x < NX; x++) AxisX[x] = (float)(OriginX + x * Step) * Scale;
+		for (int32 y = 0; y < NY; y++) AxisY[y] = (float)(OriginY + y * Step) * Scale;
+	};
+
+	auto ScaleAxes = [&](float Scale)
+	{
+		for (float& V : AxisX) V = Scale * V;
+		for (float& V : AxisY) V = Scale * V;
+	};
+
+	TArray<float> Continents;
+	Continents.SetNumUninitialized(Num);
+	FillAxes(ContinentFrequency);
+	Noise.Perlin2DGrid(AxisX.GetData(), NX, AxisY.GetData(), NY, Continents.GetData());
+
+	// Biome weights at the grid nodes around the samples, then bilinear per sample. Samples keep increasing along
+	// each axis, so the nodes they touch come out sorted and each sample only looks at the end of the list.
+	const int32 BiomeStep = GetBiomeGridStep();
+
+	struct FBiomeAxis
+	{
+		TArray<int32> Nodes;
+		TArray<int32> Slots;
+		TArray<float> Alphas;
+	};
+
+	auto MapBiomeAxis = [BiomeStep, Step](int32 Origin, int32 NumSamples, FBiomeAxis& Axis)
+	{
+		Axis.Slots.SetNumUninitialized(NumSamples);
+		Axis.Alphas.SetNumUninitialized(NumSamples);
+
+		for (int32 i = 0; i < NumSamples; i++)
+		{
+			int32 Node;
+			float Alpha;
+			FBiomeWeightGrid::Locate((float)(Origin + i * Step), BiomeStep, Node, Alpha);
+
+			if (Axis.Nodes.Num() == 0 || Axis.Nodes.Last() < Node) Axis.Nodes.Add(Node);
+
+			int32 Slot = Axis.Nodes.Num() - 1;
+			if (Axis.Nodes[Slot] != Node) Slot--;
+
+			if (Alpha != 0.0f && Slot == Axis.Nodes.Num() - 1) Axis.Nodes.Add(Node + 1);
+
+			Axis.Slots[i] = Slot;
+			Axis.Alphas[i] = Alpha;
+		}
+	};
+
+	FBiomeAxis BiomeAxisX;
+	FBiomeAxis BiomeAxisY;
+	MapBiomeAxis(OriginX, NX, BiomeAxisX);
+	MapBiomeAxis(OriginY, NY, BiomeAxisY);
+
+	const int32 NumNodesX = BiomeAxisX.Nodes.Num();
+	const int32 NumNodesY = BiomeAxisY.Nodes.Num();
+
+	TArray<FBiomeWeights> NodeWeights;
+	NodeWeights.SetNumUninitialized(NumNodesX * NumNodesY);
+	EvaluateBiomeNodes(BiomeAxisX.Nodes.GetData(), NumNodesX, BiomeAxisY.Nodes.GetData(), NumNodesY, NodeWeights.GetData());
+
+	TArray<uint8> SecondaryBiomes;
+	TArray<float> Blends;
+	SecondaryBiomes.SetNumUninitialized(Num);
+	Blends.SetNumUninitialized(Num);
+
+	bool bNeedsBiome[FBiomeWeights::MaxBiomes] = {};
+
+	for (int32 i = 0; i < Num; i++)
+	{
+		const int32 X0 = BiomeAxisX.Slots[i % NX];
+		const int32 Y0 = BiomeAxisY.Slots[i / NX];
+		const float AlphaX = BiomeAxisX.Alphas[i % NX];
+		const float AlphaY = BiomeAxisY.Alphas[i / NX];
+		const int32 X1 = AlphaX != 0.0f ? X0 + 1 : X0;
+		const int32 Y1 = AlphaY != 0.0f ? Y0 + 1 : Y0;
+
+		const FBiomeWeights Weights = FBiomeWeights::Bilinear(
+			NodeWeights[X0 + Y0 * NumNodesX], NodeWeights[X1 + Y0 * NumNodesX],
+			NodeWeights[X0 + Y1 * NumNodesX], NodeWeights[X1 + Y1 * NumNodesX],
+			AlphaX, AlphaY);
+
+		PickDominantBiomes(Weights, OutBiomes[i], SecondaryBiomes[i], Blends[i]);
+
+		bNeedsBiome[OutBiomes[i]] = true;
+
+		// A zero blend weight leaves the primary height untouched, so the secondary terrain is not needed
+		if (Blends[i] != 0.0f)
+		{
+			bNeedsBiome[SecondaryBiomes[i]] = true;
+		}
+	}
+
+	// Biome terrains, only for biomes some column actually uses
+	TArray<float> Octaves[FBiomeTable::MaxOctaves];
+	TArray<float> BiomeHeights[FBiomeWeights::MaxBiomes];
+
+	for (int32 Biome = 0; Biome < BiomeTable.Num(); Biome++)
+	{
+		if (!bNeedsBiome[Biome]) continue;
+
+		const FBiomeTable::FEntry& Entry = BiomeTable.Entries[Biome];
+
+		FillAxes(Entry.Frequency);
+
+		for (int32 Octave = 0; Octave < Entry.NumOctaves; Octave++)
+		{
+			// Octaves double the frequency, which is exact in float just like the 2 * nx / 4 * nx of the per-sample path
+			if (Octave > 0) ScaleAxes(2.0f);
+
+			Octaves[Octave].SetNumUninitialized(Num);
+			Noise.Perlin2DGrid(AxisX.GetData(), NX, AxisY.GetData(), NY, Octaves[Octave].GetData());
+		}
+
+		TArray<float>& Heights = BiomeHeights[Biome];
+		Heights.SetNumUninitialized(Num);
+
+		float ColumnOctaves[FBiomeTable::MaxOctaves];
+		for (int32 i = 0; i < Num; i++)
+		{
+			for (int32 Octave = 0; Octave < Entry.NumOctaves; Octave++) ColumnOctaves[Octave] = Octaves[Octave][i];
+			Heights[i] = BiomeTable.HeightFromOctaves(Biome, ColumnOctaves);
+		}
+	}
+
+	TArray<float> Rivers;
+	if (EnableRivers)
+	{
+		Rivers.SetNumUninitialized(Num);
+		FillAxes(RiverFrequency);
+		Noise.Perlin2DGrid(AxisX.GetData(), NX, AxisY.GetData(), NY, Rivers.GetData());
+	}
+
+	TArray<float> Surface;
+	Surface.SetNumUninitialized(Num);
+	FillAxes(0.1f);
+	Noise.Perlin2DGrid(AxisX.GetData(), NX, AxisY.GetData(), NY, Surface.GetData());
+
+	for (int32 i = 0; i < Num; i++)
+	{
+		float continents = Continents[i] * ContinentAmplitude + ContinentBaseHeight;
+
+		float h0 = BiomeHeights[OutBiomes[i]][i];
+		float h1 = Blends[i] != 0.0f ? BiomeHeights[SecondaryBiomes[i]][i] : h0;
+
+		float biomeHeight = FMath::Lerp(h0, h1, Blends[i]);
+
+		float Height = continents + biomeHeight;
+
+		if (EnableRivers)
+		{
+			Height = ApplyRiverNoise(Rivers[i], Height);
+		}
+
+		float surfaceNoise = Surface[i] * SurfaceNoiseAmplitude;
+		Height += surfaceNoise;
+
+		OutHeights[i] = Height;
+	}
+
+	if (OutBiomeGrid)
+	{
+		OutBiomeGrid->Step = BiomeStep;
+
+		// Samples at most one node apart touch every node in between, so the nodes form a plain grid
+		if (Step <= BiomeStep)
+		{
+			OutBiomeGrid->Origin = FIntPoint(BiomeAxisX.Nodes[0], BiomeAxisY.Nodes[0]);
+			OutBiomeGrid->Size = FIntPoint(NumNodesX, NumNodesY);
+			OutBiomeGrid->Weights = MoveTemp(NodeWeights);
+		}
+	}
+}
@@ -0,0 +1,264 @@
+#include "TerrainNoise.h"
+#include "Math/VectorRegister.h"
+
+#define TERRAIN_NOISE_SIMD PLATFORM_ENABLE_VECTORINTRINSICS
+
+namespace TerrainNoise
+{
+	// Same table FMath::PerlinNoise2D uses
+	static const int32 ReferencePermutation[256] = {
+		63, 9, 212, 205, 31, 128, 72, 59, 137, 203, 195, 170, 181, 115, 165, 40, 116, 139, 175, 225, 132, 99, 222, 2, 41, 15, 197, 93, 169, 90, 228, 43,
+		221, 38, 206, 204, 73, 17, 97, 10, 96, 47, 32, 138, 136, 30, 219, 78, 224, 13, 193, 88, 134, 211, 7, 112, 176, 19, 106, 83, 75, 217, 85, 0,
+		98, 140, 229, 80, 118, 151, 117, 251, 103, 242, 81, 238, 172, 82, 110, 4, 227, 77, 243, 46, 12, 189, 34, 188, 200, 161, 68, 76, 171, 194, 57, 48,
+		247, 233, 51, 105, 5, 23, 42, 50, 216, 45, 239, 148, 249, 84, 70, 125, 108, 241, 62, 66, 64, 240, 173, 185, 250, 49, 6, 37, 26, 21, 244, 60,
+		223, 255, 16, 145, 27, 109, 58, 102, 142, 253, 120, 149, 160, 124, 156, 79, 186, 135, 127, 14, 121, 22, 65, 54, 153, 91, 213, 174, 24, 252, 131, 192,
+		190, 202, 208, 35, 94, 231, 56, 95, 183, 163, 111, 147, 25, 67, 36, 92, 236, 71, 166, 1, 187, 100, 130, 143, 237, 178, 158, 104, 184, 159, 177, 52,
+		214, 230, 119, 87, 114, 201, 179, 198, 3, 248, 182, 39, 11, 152, 196, 113, 20, 232, 69, 141, 207, 234, 53, 86, 180, 226, 74, 150, 218, 29, 133, 8,
+		44, 123, 28, 146, 89, 101, 154, 220, 126, 155, 122, 210, 168, 254, 162, 129, 33, 18, 209, 61, 191, 199, 157, 245, 55, 164, 167, 215, 246, 144, 107, 235
+	};
+
+	// Corners and major axes, selected by Hash & 7
+	FORCEINLINE float Grad2(int32 Hash, float X, float Y)
+	{
+		switch (Hash & 7)
+		{
+		case 0: return X;
+		case 1: return X + Y;
+		case 2: return Y;
+		case 3: return -X + Y;
+		case 4: return -X;
+		case 5: return -X - Y;
+		case 6: return -Y;
+		case 7: return X - Y;
+		default: return 0;
+		}
+	}
+
+	FORCEINLINE float SmoothCurve(float X)
+	{
+		return X * X * X * (X * (X * 6.0f - 15.0f) + 10.0f);
+	}
+
+#if TERRAIN_NOISE_SIMD
+	// Grad2 as coefficient pairs, so four gradients can be evaluated as GradX * X + GradY * Y.
+	// Multiplying by 0/1/-1 is exact, which keeps the result identical to the switch above.
+	static const float GradX[8] = { 1.0f, 1.0f, 0.0f, -1.0f, -1.0f, -1.0f, 0.0f, 1.0f };
+	static const float GradY[8] = { 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, -1.0f, -1.0f, -1.0f };
+
+	FORCEINLINE VectorRegister4Float Grad2x4(const int32 Hash[4], const VectorRegister4Float& X, const VectorRegister4Float& Y)
+	{
+		const VectorRegister4Float CX = MakeVectorRegisterFloat(GradX[Hash[0] & 7], GradX[Hash[1] & 7], GradX[Hash[2] & 7], GradX[Hash[3] & 7]);
+		const VectorRegister4Float CY = MakeVectorRegisterFloat(GradY[Hash[0] & 7], GradY[Hash[1] & 7], GradY[Hash[2] & 7], GradY[Hash[3] & 7]);
+		return VectorAdd(VectorMultiply(CX, X), VectorMultiply(CY, Y));
+	}
+
+	// FMath::Lerp operation order: A + Alpha * (B - A)
+	FORCEINLINE VectorRegister4Float Lerp4(const VectorRegister4Float& A, const VectorRegister4Float& B, const VectorRegister4Float& Alpha)
+	{
+		return VectorAdd(A, VectorMultiply(Alpha, VectorSubtract(B, A)));
+	}
+#endif
+}
+
+FTerrainNoise::FTerrainNoise(int32 InSeed)
+	: Seed(InSeed)
+{
+	BuildPermutation();
+}
+
+void FTerrainNoise::SetSeed(int32 InSeed)
+{
+	if (InSeed == Seed) return;
+
+	Seed = InSeed;
+	BuildPermutation();
+}
+
+void FTerrainNoise::BuildPermutation()
+{
+	uint8 Table[256];
+	for (int32 i = 0; i < 256; ++i)
+	{
+		Table[i] = (uint8)TerrainNoise::ReferencePermutation[i];
+	}
+
+	// Fisher-Yates over the reference table, driven by SplitMix64. Integer only, so every platform builds the same table.
+	if (Seed != 0)
+	{
+		uint64 State = (uint64)(uint32)Seed;
+
+		for (int32 i = 255; i > 0; --i)
+		{
+			State += 0x9E3779B97F4A7C15ull;
+			uint64 Z = State;
+			Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBull;
+			Z ^= Z >> 31;
+
+			Swap(Table[i], Table[(int32)(Z % (uint64)(i + 1))]);
+		}
+	}
+
+	for (int32 i = 0; i < 512; ++i)
+	{
+		Permutation[i] = Table[i & 255];
+	}
+}
+
+FTerrainNoise::FAxis FTerrainNoise::MakeAxis(float Coord)
+{
+	const float Floor = FMath::FloorToFloat(Coord);
+
+	FAxis Axis;
+	Axis.Cell = (int32)Floor & 255;
+	Axis.Frac = Coord - Floor;
+	Axis.FracM1 = Axis.Frac - 1.0f;
+	Axis.Fade = TerrainNoise::SmoothCurve(Axis.Frac);
+	return Axis;
+}
+
+float FTerrainNoise::Sample(const FAxis& AX, const FAxis& AY) const
+{
+	using namespace TerrainNoise;
+
+	const uint8* P = Permutation;
+	const int32 AA = P[AX.Cell] + AY.Cell;
+	const int32 AB = AA + 1;
+	const int32 BA = P[AX.Cell + 1] + AY.Cell;
+	const int32 BB = BA + 1;
+
+	return FMath::Lerp(
+		FMath::Lerp(Grad2(P[AA], AX.Frac, AY.Frac), Grad2(P[BA], AX.FracM1, AY.Frac), AX.Fade),
+		FMath::Lerp(Grad2(P[AB], AX.Frac, AY.FracM1), Grad2(P[BB], AX.FracM1, AY.FracM1), AX.Fade),
+		AY.Fade);
+}
+
+float FTerrainNoise::Perlin2D(float X, float Y) const
+{
+	return Sample(MakeAxis(X), MakeAxis(Y));
+}
+
+void FTerrainNoise::Perlin2DGrid(const float* Xs, int32 NumX, const float* Ys, int32 NumY, float* Out) const
+{
+	if (NumX <= 0 || NumY <= 0) return;
+
+	const uint8* P = Permutation;
+
+	// Column terms are the same for every row, so split them out once. Kept as separate arrays for vector loads.
+	TArray<FAxis, TInlineAllocator<64>> Columns;
+	TArray<int32, TInlineAllocator<64>> ColumnP0;
+	TArray<int32, TInlineAllocator<64>> ColumnP1;
+	TArray<float, TInlineAllocator<64>> ColumnFrac;
+	TArray<float, TInlineAllocator<64>> ColumnFracM1;
+	TArray<float, TInlineAllocator<64>> ColumnFade;
+
+	Columns.SetNumUninitialized(NumX);
+	ColumnP0.SetNumUninitialized(NumX);
+	ColumnP1.SetNumUninitialized(NumX);
+	ColumnFrac.SetNumUninitialized(NumX);
+	ColumnFracM1.SetNumUninitialized(NumX);
+	ColumnFade.SetNumUninitialized(NumX);
+
+	for (int32 x = 0; x < NumX; ++x)
+	{
+		const FAxis AX = MakeAxis(Xs[x]);
+		Columns[x] = AX;
+		ColumnP0[x] = P[AX.Cell];
+		ColumnP1[x] = P[AX.Cell + 1];
+		ColumnFrac[x] = AX.Frac;
+		ColumnFracM1[x] = AX.FracM1;
+		ColumnFade[x] = AX.Fade;
+	}
+
+	for (int32 y = 0; y < NumY; ++y)
+	{
+		const FAxis AY = MakeAxis(Ys[y]);
+		float* Row = Out + y * NumX;
+		int32 x = 0;
+
+#if TERRAIN_NOISE_SIMD
+		const VectorRegister4Float Y0 = VectorSetFloat1(AY.Frac);
+		const VectorRegister4Float Y1 = VectorSetFloat1(AY.FracM1);
+		const VectorRegister4Float V = VectorSetFloat1(AY.Fade);
+
+		for (; x + 4 <= NumX; x += 4)
+		{
+			int32 H00[4], H10[4], H01[4], H11[4];
+
+			for (int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				const int32 AA = ColumnP0[x + Lane] + AY.Cell;
+				const int32 BA = ColumnP1[x + Lane] + AY.Cell;
+				H00[Lane] = P[AA];
+				H01[Lane] = P[AA + 1];
+				H10[Lane] = P[BA];
+				H11[Lane] = P[BA + 1];
+			}
+
+			const VectorRegister4Float X0 = VectorLoad(ColumnFrac.GetData() + x);
+			const VectorRegister4Float X1 = VectorLoad(ColumnFracM1.GetData() + x);
+			const VectorRegister4Float U = VectorLoad(ColumnFade.GetData() + x);
+
+			const VectorRegister4Float Bottom = TerrainNoise::Lerp4(TerrainNoise::Grad2x4(H00, X0, Y0), TerrainNoise::Grad2x4(H10, X1, Y0), U);
+			const VectorRegister4Float Top = TerrainNoise::Lerp4(TerrainNoise::Grad2x4(H01, X0, Y1), TerrainNoise::Grad2x4(H11, X1, Y1), U);
+
+			VectorStore(TerrainNoise::Lerp4(Bottom, Top, V), Row + x);
+		}
+#endif
+
+		for (; x < NumX; ++x)
+		{
+			Row[x] = Sample(Columns[x], AY);
+		}
+	}
+}
+
+void FTerrainNoise::Perlin2DPoints(const float* Xs, const float* Ys, int32 Num, float* Out) const
+{
+	int32 i = 0;
+
+#if TERRAIN_NOISE_SIMD
+	const uint8* P = Permutation;
+
+	for (; i + 4 <= Num; i += 4)
+	{
+		float X0[4], X1[4], U[4], Y0[4], Y1[4], V[4];
+		int32 H00[4], H10[4], H01[4], H11[4];
+
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const FAxis AX = MakeAxis(Xs[i + Lane]);
+			const FAxis AY = MakeAxis(Ys[i + Lane]);
+
+			X0[Lane] = AX.Frac;
+			X1[Lane] = AX.FracM1;
+			U[Lane] = AX.Fade;
+			Y0[Lane] = AY.Frac;
+			Y1[Lane] = AY.FracM1;
+			V[Lane] = AY.Fade;
+
+			const int32 AA = P[AX.Cell] + AY.Cell;
+			const int32 BA = P[AX.Cell + 1] + AY.Cell;
+			H00[Lane] = P[AA];
+			H01[Lane] = P[AA + 1];
+			H10[Lane] = P[BA];
+			H11[Lane] = P[BA + 1];
+		}
+
+		const VectorRegister4Float VX0 = VectorLoad(X0);
+		const VectorRegister4Float VX1 = VectorLoad(X1);
+		const VectorRegister4Float VY0 = VectorLoad(Y0);
+		const VectorRegister4Float VY1 = VectorLoad(Y1);
+
+		const VectorRegister4Float Bottom = TerrainNoise::Lerp4(TerrainNoise::Grad2x4(H00, VX0, VY0), TerrainNoise::Grad2x4(H10, VX1, VY0), VectorLoad(U));
+		const VectorRegister4Float Top = TerrainNoise::Lerp4(TerrainNoise::Grad2x4(H01, VX0, VY1), TerrainNoise::Grad2x4(H11, VX1, VY1), VectorLoad(U));
+
+		VectorStore(TerrainNoise::Lerp4(Bottom, Top, VectorLoad(V)), Out + i);
+	}
+#endif
+
+	for (; i < Num; ++i)
+	{
+		Out[i] = Perlin2D(Xs[i], Ys[i]);
+	}
+}
@@ -0,0 +1,381 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TerrainGenerator.h"
+#include "WorldChunk.h"
+#include "ChunkMesher.h"
+#include "VoxelRenderMode.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/StrongObjectPtr.h"
+
+// Headless benchmark of terrain generation and meshing, with no world or rendering involved:
+//
+//   UnrealEditor-Cmd ProceduralSurvival.uproject -nullrhi -unattended -ExecCmds="Automation RunTests ProceduralSurvival.Benchmark; Quit"
+//
+// Results go to Saved/Benchmarks/TerrainBenchmark.json, or to the path given with -TerrainBenchmarkOut=. Counts and
+// checksums only change when generation or meshing output changes; rates and memory vary from run to run.
+namespace TerrainBenchmark
+{
+	constexpr int32 ChunkSizeXY = 32;
+	constexpr int32 ChunkHeightZ = 32;
+
+	// Each timing is the fastest of this many runs
+	constexpr int32 Repeats = 3;
+
+	// Chunk columns spread over all biomes at the generator's default settings
+	const FIntPoint Columns[] = {
+		FIntPoint(0, 0),
+		FIntPoint(3, -2),
+		FIntPoint(17, 41),
+		FIntPoint(-64, 25),
+		FIntPoint(120, -90),
+		FIntPoint(-300, -211),
+		FIntPoint(512, 377),
+		FIntPoint(-1000, 640)
+	};
+
+	template <typename FuncType>
+	double TimeBest(FuncType&& Body)
+	{
+		double Best = TNumericLimits<double>::Max();
+
+		for (int32 Run = 0; Run < Repeats; ++Run)
+		{
+			const double Start = FPlatformTime::Seconds();
+			Body();
+			Best = FMath::Min(Best, FPlatformTime::Seconds() - Start);
+		}
+
+		return FMath::Max(Best, 1e-9);
+	}
+
+	// The process high-water mark, which only rises. A stage that raises it allocated more than anything before it.
+	double GetPeakUsedPhysicalMB()
+	{
+		return FPlatformMemory::GetStats().PeakUsedPhysical / (1024.0 * 1024.0);
+	}
+
+	FString GetOutputPath()
+	{
+		FString Path;
+		if (FParse::Value(FCommandLine::Get(), TEXT("TerrainBenchmarkOut="), Path)) return Path;
+
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), TEXT("TerrainBenchmark.json"));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainGenerationBenchmark, "ProceduralSurvival.Benchmark.TerrainGeneration",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FTerrainGenerationBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace TerrainBenchmark;
+
+	// Class defaults, not whatever a level's world manager overrides, so every build measures the same terrain
+	TStrongObjectPtr<UTerrainGenerator> Generator(NewObject<UTerrainGenerator>());
+
+	const int32 NumColumns = UE_ARRAY_COUNT(Columns);
+	const int32 ColumnsPerChunk = ChunkSizeXY * ChunkSizeXY;
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("BuildVersion"), FApp::GetBuildVersion());
+	Root->SetStringField(TEXT("BuildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetNumberField(TEXT("ChunkSizeXY"), ChunkSizeXY);
+	Root->SetNumberField(TEXT("ChunkHeightZ"), ChunkHeightZ);
+	Root->SetNumberField(TEXT("Columns"), NumColumns);
+	Root->SetNumberField(TEXT("Seed"), Generator->Seed);
+
+	// Heights, per sample and batched. Both sum to the same checksum or the batched path has drifted.
+	{
+		double SampleChecksum = 0.0;
+		const double SampleSeconds = TimeBest([&]()
+		{
+			SampleChecksum = 0.0;
+			for (const FIntPoint& ColumnXY : Columns)
+			{
+				for (int32 Y = 0; Y < ChunkSizeXY; ++Y)
+				{
+					for (int32 X = 0; X < ChunkSizeXY; ++X)
+					{
+						SampleChecksum += Generator->GetTerrainHeight(ColumnXY.X * ChunkSizeXY + X, ColumnXY.Y * ChunkSizeXY + Y);
+					}
+				}
+			}
+		});
+
+		double BatchedChecksum = 0.0;
+		FTerrainColumnField Field;
+		const double BatchedSeconds = TimeBest([&]()
+		{
+			BatchedChecksum = 0.0;
+			for (const FIntPoint& ColumnXY : Columns)
+			{
+				Generator->GenerateColumnField(ColumnXY.X * ChunkSizeXY, ColumnXY.Y * ChunkSizeXY, ChunkSizeXY, ChunkSizeXY, Field);
+				for (float Height : Field.Heights)
+				{
+					BatchedChecksum += Height;
+				}
+			}
+		});
+
+		TestEqual(TEXT("Batched heights match per-sample heights"), BatchedChecksum, SampleChecksum, 1e-3);
+
+		const int32 NumSamples = NumColumns * ColumnsPerChunk;
+
+		TSharedRef<FJsonObject> Stage = MakeShared<FJsonObject>();
+		Stage->SetNumberField(TEXT("VoxelColumns"), NumSamples);
+		Stage->SetNumberField(TEXT("HeightChecksum"), SampleChecksum);
+		Stage->SetNumberField(TEXT("PerSampleColumnsPerSec"), NumSamples / SampleSeconds);
+		Stage->SetNumberField(TEXT("BatchedColumnsPerSec"), NumSamples / BatchedSeconds);
+		Root->SetObjectField(TEXT("TerrainHeight"), Stage);
+
+		AddInfo(FString::Printf(TEXT("Heights: %.0f columns/s per sample, %.0f columns/s batched"), NumSamples / SampleSeconds, NumSamples / BatchedSeconds));
+	}
+
+	// A height checksum per fixed seed. A seed whose checksum changes no longer produces the worlds it used to.
+	{
+		const int32 Seeds[] = { 0, 1, 1337, -42 };
+
+		TStrongObjectPtr<UTerrainGenerator> SeededGenerator(NewObject<UTerrainGenerator>());
+		TSharedRef<FJsonObject> Checksums = MakeShared<FJsonObject>();
+		TArray<double> SeedChecksums;
+
+		for (int32 Seed : Seeds)
+		{
+			SeededGenerator->SetSeed(Seed);
+
+			double Checksum = 0.0;
+			FTerrainColumnField Field;
+			for (const FIntPoint& ColumnXY : Columns)
+			{
+				SeededGenerator->GenerateColumnField(ColumnXY.X * ChunkSizeXY, ColumnXY.Y * ChunkSizeXY, ChunkSizeXY, ChunkSizeXY, Field);
+				for (float Height : Field.Heights)
+				{
+					Checksum += Height;
+				}
+			}
+
+			Checksums->SetNumberField(FString::FromInt(Seed), Checksum);
+			SeedChecksums.Add(Checksum);
+		}
+
+		for (int32 i = 0; i < SeedChecksums.Num(); ++i)
+		{
+			for (int32 j = i + 1; j < SeedChecksums.Num(); ++j)
+			{
+				TestTrue(FString::Printf(TEXT("Seeds %d and %d produce different terrain"), Seeds[i], Seeds[j]), SeedChecksums[i] != SeedChecksums[j]);
+			}
+		}
+
+		Root->SetObjectField(TEXT("SeedHeightChecksums"), Checksums);
+	}
+
+	// Voxels for every section the surface passes through, which is what a column job does
+	TArray<FChunkColumnRecord> Records;
+	{
+		const double PeakBefore = GetPeakUsedPhysicalMB();
+
+		const double Seconds = TimeBest([&]()
+		{
+			Records.Reset();
+			Records.SetNum(NumColumns);
+
+			for (int32 i = 0; i < NumColumns; ++i)
+			{
+				AWorldChunk::GenerateColumnRecord(*Generator, Columns[i], ChunkSizeXY, ChunkHeightZ, Records[i]);
+			}
+		});
+
+		int32 NumSections = 0;
+		SIZE_T VoxelBytes = 0;
+		SIZE_T PeakSectionBytes = 0;
+
+		for (const FChunkColumnRecord& Record : Records)
+		{
+			for (const FChunkSectionVoxels& Section : Record.Sections)
+			{
+				++NumSections;
+				VoxelBytes += Section.Voxels.GetAllocatedSize();
+				PeakSectionBytes = FMath::Max(PeakSectionBytes, Section.Voxels.GetAllocatedSize());
+			}
+		}
+
+		const int64 NumVoxels = (int64)NumSections * ColumnsPerChunk * ChunkHeightZ;
+
+		TestTrue(TEXT("Every column has sections"), NumSections >= NumColumns);
+
+		TSharedRef<FJsonObject> Stage = MakeShared<FJsonObject>();
+		Stage->SetNumberField(TEXT("Sections"), NumSections);
+		Stage->SetNumberField(TEXT("Voxels"), (double)NumVoxels);
+		Stage->SetNumberField(TEXT("VoxelsPerSec"), NumVoxels / Seconds);
+		Stage->SetNumberField(TEXT("ChunkColumnsPerSec"), NumColumns / Seconds);
+		Stage->SetNumberField(TEXT("VoxelBytes"), (double)VoxelBytes);
+		Stage->SetNumberField(TEXT("PeakSectionBytes"), (double)PeakSectionBytes);
+		Stage->SetNumberField(TEXT("ProcessPeakRiseMB"), GetPeakUsedPhysicalMB() - PeakBefore);
+		Root->SetObjectField(TEXT("VoxelGeneration"), Stage);
+
+		AddInfo(FString::Printf(TEXT("Voxels: %d sections, %.0f voxels/s, %llu KB stored"), NumSections, NumVoxels / Seconds, (uint64)(VoxelBytes / 1024)));
+	}
+
+	// Every section in every render mode, without neighbour borders, like a chunk with no world manager
+	{
+		const UEnum* RenderModeEnum = StaticEnum<EVoxelRenderMode>();
+		const EVoxelRenderMode Modes[] = { EVoxelRenderMode::Cubes, EVoxelRenderMode::GreedyCubes, EVoxelRenderMode::MarchingCubes };
+
+		TSharedRef<FJsonObject> MeshStages = MakeShared<FJsonObject>();
+
+		for (EVoxelRenderMode Mode : Modes)
+		{
+			TArray<FChunkMeshInput> Inputs;
+			TArray<const FVoxelStorage*> SectionVoxels;
+
+			for (int32 i = 0; i < NumColumns; ++i)
+			{
+				for (const FChunkSectionVoxels& Section : Records[i].Sections)
+				{
+					FChunkMeshInput& Input = Inputs.AddDefaulted_GetRef();
+					Input.ChunkCoords = FIntVector(Columns[i].X, Columns[i].Y, Section.SectionZ);
+					Input.ChunkSizeXY = ChunkSizeXY;
+					Input.ChunkHeightZ = ChunkHeightZ;
+					Input.RenderMode = Mode;
+					Input.TerrainGenerator = Generator.Get();
+					Input.Columns = Records[i].Columns;
+
+					SectionVoxels.Add(&Section.Voxels);
+				}
+			}
+
+			const double PeakBefore = GetPeakUsedPhysicalMB();
+
+			int64 NumTriangles = 0;
+			int64 NumVertices = 0;
+			SIZE_T MeshBytes = 0;
+			SIZE_T PeakSectionBytes = 0;
+
+			const double Seconds = TimeBest([&]()
+			{
+				NumTriangles = 0;
+				NumVertices = 0;
+				MeshBytes = 0;
+				PeakSectionBytes = 0;
+
+				// A fresh mesh per section, as every pipeline job starts with one
+				for (int32 i = 0; i < Inputs.Num(); ++i)
+				{
+					FChunkMeshData MeshData;
+					FChunkMesher(Inputs[i], *SectionVoxels[i]).Build(MeshData);
+
+					NumTriangles += MeshData.GetNumTriangles();
+					NumVertices += MeshData.GetNumVertices();
+
+					const SIZE_T Bytes = MeshData.GetAllocatedSize();
+					MeshBytes += Bytes;
+					PeakSectionBytes = FMath::Max(PeakSectionBytes, Bytes);
+				}
+			});
+
+			const int64 NumCells = (int64)Inputs.Num() * ColumnsPerChunk * ChunkHeightZ;
+			const FString ModeName = RenderModeEnum->GetNameStringByValue((int64)Mode);
+
+			TestTrue(FString::Printf(TEXT("%s emits triangles"), *ModeName), NumTriangles > 0);
+
+			TSharedRef<FJsonObject> Stage = MakeShared<FJsonObject>();
+			Stage->SetNumberField(TEXT("Sections"), Inputs.Num());
+			Stage->SetNumberField(TEXT("Cells"), (double)NumCells);
+			Stage->SetNumberField(TEXT("CellsPerSec"), NumCells / Seconds);
+			Stage->SetNumberField(TEXT("SectionsPerSec"), Inputs.Num() / Seconds);
+			Stage->SetNumberField(TEXT("Triangles"), (double)NumTriangles);
+			Stage->SetNumberField(TEXT("Vertices"), (double)NumVertices);
+			Stage->SetNumberField(TEXT("MeshBytes"), (double)MeshBytes);
+			Stage->SetNumberField(TEXT("PeakSectionBytes"), (double)PeakSectionBytes);
+			Stage->SetNumberField(TEXT("ProcessPeakRiseMB"), GetPeakUsedPhysicalMB() - PeakBefore);
+			MeshStages->SetObjectField(ModeName, Stage);
+
+			AddInfo(FString::Printf(TEXT("%s: %.0f cells/s, %lld triangles"), *ModeName, NumCells / Seconds, NumTriangles));
+		}
+
+		Root->SetObjectField(TEXT("Meshing"), MeshStages);
+	}
+
+	// Smooth sections at stride 2 with a full-detail neighbour on every side, so each one hangs skirts
+	{
+		int64 NumPlainTriangles = 0;
+		int64 NumSkirtedTriangles = 0;
+		int32 NumSections = 0;
+
+		const double Seconds = TimeBest([&]()
+		{
+			NumPlainTriangles = 0;
+			NumSkirtedTriangles = 0;
+			NumSections = 0;
+
+			for (int32 i = 0; i < NumColumns; ++i)
+			{
+				for (const FChunkSectionVoxels& Section : Records[i].Sections)
+				{
+					FChunkMeshInput Input;
+					Input.ChunkCoords = FIntVector(Columns[i].X, Columns[i].Y, Section.SectionZ);
+					Input.ChunkSizeXY = ChunkSizeXY;
+					Input.ChunkHeightZ = ChunkHeightZ;
+					Input.RenderMode = EVoxelRenderMode::MarchingCubes;
+					Input.TerrainGenerator = Generator.Get();
+					Input.Columns = Records[i].Columns;
+					Input.LodStride = 2;
+
+					FChunkMeshData Plain;
+					FChunkMesher(Input, Section.Voxels).Build(Plain);
+
+					for (int32& NeighborStride : Input.NeighborLodStride)
+					{
+						NeighborStride = 1;
+					}
+
+					FChunkMeshData Skirted;
+					FChunkMesher(Input, Section.Voxels).Build(Skirted);
+
+					NumPlainTriangles += Plain.GetNumTriangles();
+					NumSkirtedTriangles += Skirted.GetNumTriangles();
+					++NumSections;
+				}
+			}
+		});
+
+		TestTrue(TEXT("LOD seams get skirts"), NumSkirtedTriangles > NumPlainTriangles);
+
+		TSharedRef<FJsonObject> Stage = MakeShared<FJsonObject>();
+		Stage->SetNumberField(TEXT("Sections"), NumSections);
+		Stage->SetNumberField(TEXT("SectionsPerSec"), 2 * NumSections / Seconds);
+		Stage->SetNumberField(TEXT("SkirtTriangles"), (double)(NumSkirtedTriangles - NumPlainTriangles));
+		Root->SetObjectField(TEXT("LodSeams"), Stage);
+
+		AddInfo(FString::Printf(TEXT("LOD seams: %lld skirt triangles over %d sections"), NumSkirtedTriangles - NumPlainTriangles, NumSections));
+	}
+
+	Root->SetNumberField(TEXT("ProcessPeakUsedPhysicalMB"), GetPeakUsedPhysicalMB());
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	const FString OutputPath = GetOutputPath();
+	if (!FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		AddError(FString::Printf(TEXT("Could not write benchmark results to %s"), *OutputPath));
+		return false;
+	}
+
+	AddInfo(FString::Printf(TEXT("Benchmark results written to %s"), *OutputPath));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,300 @@
+#include "VoxelStorage.h"
+
+void FVoxelStorage::Init(int32 InSizeXY, int32 InSizeZ)
+{
+	SizeXY = FMath::Max(1, InSizeXY);
+	SizeZ = FMath::Max(1, InSizeZ);
+	BricksXY = (SizeXY + BrickSize - 1) / BrickSize;
+	BricksZ = (SizeZ + BrickSize - 1) / BrickSize;
+
+	Bricks.Reset();
+	Bricks.SetNum(BricksXY * BricksXY * BricksZ);
+
+	for (FBrick& Brick : Bricks)
+	{
+		Brick.Palette.Add(0);
+	}
+}
+
+bool FVoxelStorage::IsSolid(int32 X, int32 Y, int32 Z) const
+{
+	return Bricks[BrickIndex(X, Y, Z)].IsSolid(LocalIndex(X, Y, Z));
+}
+
+float FVoxelStorage::GetDensity(int32 X, int32 Y, int32 Z) const
+{
+	return DequantizeDensity(Bricks[BrickIndex(X, Y, Z)].GetDensity(LocalIndex(X, Y, Z)));
+}
+
+uint8 FVoxelStorage::GetMaterial(int32 X, int32 Y, int32 Z) const
+{
+	return Bricks[BrickIndex(X, Y, Z)].GetMaterial(LocalIndex(X, Y, Z));
+}
+
+FVoxel FVoxelStorage::Get(int32 X, int32 Y, int32 Z) const
+{
+	const FBrick& Brick = Bricks[BrickIndex(X, Y, Z)];
+	const int32 Local = LocalIndex(X, Y, Z);
+
+	FVoxel Voxel;
+	Voxel.isSolid = Brick.IsSolid(Local);
+	Voxel.density = DequantizeDensity(Brick.GetDensity(Local));
+	Voxel.materialID = Brick.GetMaterial(Local);
+	return Voxel;
+}
+
+void FVoxelStorage::Set(int32 X, int32 Y, int32 Z, const FVoxel& Voxel)
+{
+	FBrick& Brick = Bricks[BrickIndex(X, Y, Z)];
+	const int32 Local = LocalIndex(X, Y, Z);
+
+	Brick.SetSolid(Local, Voxel.isSolid);
+	Brick.SetDensity(Local, QuantizeDensity(Voxel.density));
+	Brick.SetMaterial(Local, Voxel.materialID);
+}
+
+void FVoxelStorage::SetBrick(int32 BrickX, int32 BrickY, int32 BrickZ, const FVoxel* Voxels)
+{
+	FBrick& Brick = Bricks[BrickX + BrickY * BricksXY + BrickZ * BricksXY * BricksXY];
+	Brick = FBrick();
+
+	// Voxels past the edge of a partial brick take the first voxel's values so they never break uniformity
+	const int32 EndX = FMath::Min(BrickSize, SizeXY - BrickX * BrickSize);
+	const int32 EndY = FMath::Min(BrickSize, SizeXY - BrickY * BrickSize);
+	const int32 EndZ = FMath::Min(BrickSize, SizeZ - BrickZ * BrickSize);
+
+	auto IsInside = [&](int32 Local)
+	{
+		return (Local % BrickSize) < EndX && ((Local / BrickSize) % BrickSize) < EndY && (Local / (BrickSize * BrickSize)) < EndZ;
+	};
+
+	const FVoxel& First = Voxels[0];
+	Brick.UniformSolid = First.isSolid;
+	Brick.UniformDensity = QuantizeDensity(First.density);
+	Brick.Palette.Add(First.materialID);
+
+	bool bUniformSolid = true;
+	bool bUniformDensity = true;
+	bool bUniformMaterial = true;
+
+	for (int32 Local = 1; Local < BrickVoxels; ++Local)
+	{
+		if (!IsInside(Local)) continue;
+
+		const FVoxel& Voxel = Voxels[Local];
+		bUniformSolid &= Voxel.isSolid == First.isSolid;
+		bUniformDensity &= QuantizeDensity(Voxel.density) == Brick.UniformDensity;
+		bUniformMaterial &= Voxel.materialID == First.materialID;
+	}
+
+	if (bUniformSolid && bUniformDensity && bUniformMaterial) return;
+
+	for (int32 Local = 0; Local < BrickVoxels; ++Local)
+	{
+		const FVoxel& Voxel = IsInside(Local) ? Voxels[Local] : First;
+
+		if (!bUniformSolid) Brick.SetSolid(Local, Voxel.isSolid);
+		if (!bUniformDensity) Brick.SetDensity(Local, QuantizeDensity(Voxel.density));
+		if (!bUniformMaterial) Brick.SetMaterial(Local, Voxel.materialID);
+	}
+}
+
+SIZE_T FVoxelStorage::GetAllocatedSize() const
+{
+	SIZE_T Size = Bricks.GetAllocatedSize();
+
+	for (const FBrick& Brick : Bricks)
+	{
+		Size += Brick.GetAllocatedSize();
+	}
+
+	return Size;
+}
+
+FArchive& operator<<(FArchive& Ar, FVoxelStorage& Storage)
+{
+	Ar << Storage.SizeXY << Storage.SizeZ;
+
+	int32 NumBricks = Storage.Bricks.Num();
+	Ar << NumBricks;
+
+	if (Ar.IsLoading())
+	{
+		Storage.BricksXY = (Storage.SizeXY + FVoxelStorage::BrickSize - 1) / FVoxelStorage::BrickSize;
+		Storage.BricksZ = (Storage.SizeZ + FVoxelStorage::BrickSize - 1) / FVoxelStorage::BrickSize;
+
+		if (Storage.SizeXY <= 0 || Storage.SizeZ <= 0 || NumBricks != Storage.BricksXY * Storage.BricksXY * Storage.BricksZ)
+		{
+			Ar.SetError();
+			Storage.Init(1, 1);
+			return Ar;
+		}
+
+		Storage.Bricks.Reset();
+		Storage.Bricks.SetNum(NumBricks);
+	}
+
+	for (FVoxelStorage::FBrick& Brick : Storage.Bricks)
+	{
+		Brick.Serialize(Ar);
+	}
+
+	return Ar;
+}
+
+int8 FVoxelStorage::QuantizeDensity(float Density)
+{
+	return (int8)FMath::Clamp(FMath::RoundToInt(Density / DensityStep), -127, 127);
+}
+
+bool FVoxelStorage::FBrick::IsSolid(int32 Local) const
+{
+	if (SolidBits.Num() == 0) return UniformSolid;
+
+	return (SolidBits[Local >> 6] >> (Local & 63)) & 1;
+}
+
+int8 FVoxelStorage::FBrick::GetDensity(int32 Local) const
+{
+	return Densities.Num() == 0 ? UniformDensity : Densities[Local];
+}
+
+uint8 FVoxelStorage::FBrick::GetMaterial(int32 Local) const
+{
+	if (MaterialBits == 0) return Palette[0];
+
+	const int32 Bit = Local * MaterialBits;
+	const uint8 Mask = (uint8)((1 << MaterialBits) - 1);
+	return Palette[(MaterialIndices[Bit >> 3] >> (Bit & 7)) & Mask];
+}
+
+void FVoxelStorage::FBrick::SetSolid(int32 Local, bool bSolid)
+{
+	if (SolidBits.Num() == 0)
+	{
+		if (bSolid == UniformSolid) return;
+
+		SolidBits.Init(UniformSolid ? ~0ull : 0ull, BrickVoxels / 64);
+	}
+
+	const uint64 Bit = 1ull << (Local & 63);
+
+	if (bSolid)
+	{
+		SolidBits[Local >> 6] |= Bit;
+	}
+	else
+	{
+		SolidBits[Local >> 6] &= ~Bit;
+	}
+}
+
+void FVoxelStorage::FBrick::SetDensity(int32 Local, int8 Density)
+{
+	if (Densities.Num() == 0)
+	{
+		if (Density == UniformDensity) return;
+
+		Densities.Init(UniformDensity, BrickVoxels);
+	}
+
+	Densities[Local] = Density;
+}
+
+void FVoxelStorage::FBrick::SetMaterial(int32 Local, uint8 Material)
+{
+	int32 PaletteIndex = Palette.Find(Material);
+
+	if (PaletteIndex == INDEX_NONE)
+	{
+		PaletteIndex = Palette.Add(Material);
+
+		// Grow the index width in powers of two so an index never straddles a byte
+		uint8 NeededBits = 1;
+		while ((1 << NeededBits) < Palette.Num())
+		{
+			NeededBits *= 2;
+		}
+
+		if (NeededBits > MaterialBits)
+		{
+			RepackMaterials(NeededBits);
+		}
+	}
+
+	if (MaterialBits == 0) return;
+
+	const int32 Bit = Local * MaterialBits;
+	const uint8 Mask = (uint8)(((1 << MaterialBits) - 1) << (Bit & 7));
+	uint8& Byte = MaterialIndices[Bit >> 3];
+	Byte = (Byte & ~Mask) | (uint8)((PaletteIndex << (Bit & 7)) & Mask);
+}
+
+void FVoxelStorage::FBrick::RepackMaterials(uint8 NewBits)
+{
+	TArray<uint8> OldIndices = MoveTemp(MaterialIndices);
+	const uint8 OldBits = MaterialBits;
+
+	MaterialBits = NewBits;
+	MaterialIndices.SetNumZeroed(BrickVoxels * NewBits / 8);
+
+	if (OldBits == 0) return;
+
+	const uint8 OldMask = (uint8)((1 << OldBits) - 1);
+
+	for (int32 Local = 0; Local < BrickVoxels; ++Local)
+	{
+		const int32 OldBit = Local * OldBits;
+		const uint8 Index = (OldIndices[OldBit >> 3] >> (OldBit & 7)) & OldMask;
+
+		const int32 NewBit = Local * NewBits;
+		MaterialIndices[NewBit >> 3] |= (uint8)(Index << (NewBit & 7));
+	}
+}
+
+SIZE_T FVoxelStorage::FBrick::GetAllocatedSize() const
+{
+	return SolidBits.GetAllocatedSize() + Densities.GetAllocatedSize() + Palette.GetAllocatedSize() + MaterialIndices.GetAllocatedSize();
+}
+
+void FVoxelStorage::FBrick::Serialize(FArchive& Ar)
+{
+	Ar << UniformSolid << UniformDensity << MaterialBits;
+	Ar << SolidBits << Densities << Palette << MaterialIndices;
+
+	// Readers index these arrays directly, so a corrupt record must not get through with the wrong sizes
+	if (Ar.IsLoading())
+	{
+		const bool bValidBits = MaterialBits == 0 || MaterialBits == 1 || MaterialBits == 2 || MaterialBits == 4 || MaterialBits == 8;
+
+		bool bValid =
+			(SolidBits.Num() == 0 || SolidBits.Num() == BrickVoxels / 64) &&
+			(Densities.Num() == 0 || Densities.Num() == BrickVoxels) &&
+			bValidBits && Palette.Num() > 0 && Palette.Num() <= (1 << MaterialBits) &&
+			MaterialIndices.Num() == BrickVoxels * MaterialBits / 8;
+
+		for (int32 i = 0; bValid && i < Palette.Num(); ++i)
+		{
+			bValid = Palette[i] < (uint8)EVoxelMaterial::Num;
+		}
+
+		// A palette that doesn't fill its index width leaves room for indices past its end
+		if (bValid && MaterialBits > 0 && Palette.Num() < (1 << MaterialBits))
+		{
+			const uint8 Mask = (uint8)((1 << MaterialBits) - 1);
+
+			for (int32 Local = 0; bValid && Local < BrickVoxels; ++Local)
+			{
+				const int32 Bit = Local * MaterialBits;
+				bValid = ((MaterialIndices[Bit >> 3] >> (Bit & 7)) & Mask) < Palette.Num();
+			}
+		}
+
+		if (!bValid)
+		{
+			Ar.SetError();
+			*this = FBrick();
+			Palette.Add(0);
+		}
+	}
+}
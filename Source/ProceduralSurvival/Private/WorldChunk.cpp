@@ -1,9 +1,12 @@
 #include "WorldChunk.h"
+#include "ProceduralSurvival.h"
 #include "WorldManager.h"
 #include "TerrainGenerator.h"
-#include "MarchingCubeTables.h"
 #include "Engine/World.h"
+#include "PhysicsEngine/BodySetup.h"
 
+// Longest a collision cook is waited on. A failed cook never swaps the body setup in.
+static constexpr double CollisionCookTimeout = 5.0;
 
 AWorldChunk::AWorldChunk()
 {
@@ -11,6 +14,14 @@ AWorldChunk::AWorldChunk()
 
     Mesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMesh"));
     RootComponent = Mesh;
+
+    // Cooking on the game thread was most of the cost of uploading a chunk mesh
+    Mesh->bUseAsyncCooking = true;
+
+    for (UMaterialInterface*& VoxelMaterial : VoxelMaterials)
+    {
+        VoxelMaterial = nullptr;
+    }
 }
 
 void AWorldChunk::BeginPlay()
@@ -18,7 +29,7 @@ void AWorldChunk::BeginPlay()
     Super::BeginPlay();
 }
 
-void AWorldChunk::InitializeChunk(int InChunkSizeXY, int InChunkHeightZ, float InVoxelScale, const FIntPoint& InChunkCoords)
+void AWorldChunk::InitializeChunk(int InChunkSizeXY, int InChunkHeightZ, float InVoxelScale, const FIntVector& InChunkCoords)
 {
     ChunkSizeXY = FMath::Max(1, InChunkSizeXY);
     ChunkHeightZ = FMath::Max(1, InChunkHeightZ);
@@ -26,12 +37,31 @@ void AWorldChunk::InitializeChunk(int InChunkSizeXY, int InChunkHeightZ, float I
     VoxelScale = InVoxelScale;
     ChunkCoords = InChunkCoords;
 
-    const int32 Total = ChunkSizeXY * ChunkSizeXY * ChunkHeightZ;
-    VoxelData.SetNumZeroed(Total);
+    VoxelData.Init(ChunkSizeXY, ChunkHeightZ);
+
+    bHasVoxels = false;
+    bModified = false;
+    DirtyMin = FIntVector(MAX_int32);
+    DirtyMax = FIntVector(MIN_int32);
+    ++VoxelRevision;
 
     isInitialized = true;
 }
 
+void AWorldChunk::Deactivate()
+{
+    SetActorHiddenInGame(true);
+    SetActorEnableCollision(false);
+
+    bHasVoxels = false;
+    ++VoxelRevision;
+    NumMeshTriangles = 0;
+    bHasMesh = false;
+    bMeshHasCollision = false;
+    bCollisionPending = false;
+    isInitialized = false;
+}
+
 int AWorldChunk::LocalIndex(int X, int Y, int Z) const
 {
     if (X < 0 || X >= ChunkSizeXY || Y < 0 || Y >= ChunkSizeXY || Z < 0 || Z >= ChunkHeightZ)
@@ -51,7 +81,7 @@ bool AWorldChunk::IsVoxelSolidLocal(int LocalX, int LocalY, int LocalZ) const
     int Index = LocalIndex(LocalX, LocalY, LocalZ);
     if (Index < 0) return false;
 
-    return VoxelData[Index].isSolid;
+    return VoxelData.IsSolid(LocalX, LocalY, LocalZ);
 }
 
 void AWorldChunk::SetVoxelLocal(int LocalX, int LocalY, int LocalZ, bool isSolid)
@@ -60,472 +90,311 @@ void AWorldChunk::SetVoxelLocal(int LocalX, int LocalY, int LocalZ, bool isSolid
 
     int Index = LocalIndex(LocalX, LocalY, LocalZ);
     if (Index < 0) return;
-    VoxelData[Index].isSolid = isSolid;
-
-    GenerateMesh();
-}
-
-void AWorldChunk::GenerateVoxels()
-{
-
-    if (!isInitialized || !WorldManager || !WorldManager->TerrainGenerator) return;
-
-	UTerrainGenerator* TerrainGen = WorldManager->TerrainGenerator;
+    FVoxel Voxel = VoxelData.Get(LocalX, LocalY, LocalZ);
+    Voxel.isSolid = isSolid;
 
-	const int32 BaseX = ChunkCoords.X * ChunkSizeXY;
-	const int32 BaseY = ChunkCoords.Y * ChunkSizeXY;
+    // Smooth meshes are built from density, so push it across the surface to match the new state
+    Voxel.density = isSolid ? FMath::Max(Voxel.density, 0.5f) : FMath::Min(Voxel.density, -0.5f);
+    VoxelData.Set(LocalX, LocalY, LocalZ, Voxel);
+    ++VoxelRevision;
+    bModified = true;
 
-    for (int x = 0; x < ChunkSizeXY; x++)
+    if (!WorldManager)
     {
-        for (int y = 0; y < ChunkSizeXY; y++)
-        {
-            const float GX = BaseX + x;
-			const float GY = BaseY + y;
-
-            for (int z = 0; z < ChunkHeightZ; z++)
-            {
-				const float GZ = z;
-
-                int32 Index = LocalIndex(x, y, z);
-                if (Index < 0) continue;
-
-                FVoxel& Voxel = VoxelData[Index];
+        GenerateMesh();
+        return;
+    }
 
-				float Density = TerrainGen->GetDensity(GX, GY, GZ);
+    DirtyMin = FIntVector(FMath::Min(DirtyMin.X, LocalX), FMath::Min(DirtyMin.Y, LocalY), FMath::Min(DirtyMin.Z, LocalZ));
+    DirtyMax = FIntVector(FMath::Max(DirtyMax.X, LocalX), FMath::Max(DirtyMax.Y, LocalY), FMath::Max(DirtyMax.Z, LocalZ));
 
-                Voxel.density = Density;
-                Voxel.isSolid = (Density >= 0.0f);
-                
-            }
-        }
-    }
+    WorldManager->MarkChunkEdited(ChunkCoords);
 }
 
-void AWorldChunk::AddCubeFace(int FaceIndex, FVector& Position, FColor FaceColor, TArray<FVector>& Vertices, TArray<int32>& Triangles, TArray<FVector>& Normals, TArray<FVector2D>& UVs, TArray<FColor>& VertexColors)
+bool AWorldChunk::ConsumeDirtyBox(FIntVector& OutMin, FIntVector& OutMax)
 {
-    float S = VoxelScale;
-
-    struct FCubeFace
-    {
-        FVector Normal;
-        FVector Verts[4];
-    };
+    if (DirtyMin.X > DirtyMax.X) return false;
 
-    FCubeFace Faces[6] =
-    {
-        // Right
-        { FVector(1,0,0), {
-            Position + FVector(S,0,0),
-            Position + FVector(S,0,S),
-            Position + FVector(S,S,S),
-            Position + FVector(S,S,0) } 
-        },
-
-        // Left
-        { FVector(-1,0,0), {
-            Position + FVector(0,0,0),
-            Position + FVector(0,S,0),
-            Position + FVector(0,S,S),
-            Position + FVector(0,0,S) } 
-        },
-
-        // Front
-        { FVector(0,1,0), {
-            Position + FVector(0,S,0),
-            Position + FVector(S,S,0),
-            Position + FVector(S,S,S),
-            Position + FVector(0,S,S) } 
-        },
-
-        // Back
-        { FVector(0,-1,0), {
-            Position + FVector(0,0,0),
-            Position + FVector(0,0,S),
-            Position + FVector(S,0,S),
-            Position + FVector(S,0,0) } 
-        },
-
-        // Top
-        { FVector(0,0,1), {
-            Position + FVector(0,0,S),
-            Position + FVector(0,S,S),
-            Position + FVector(S,S,S),
-            Position + FVector(S,0,S) } 
-        },
-
-        // Bottom
-        { FVector(0,0,-1), {
-            Position + FVector(0,0,0),
-            Position + FVector(S,0,0),
-            Position + FVector(S,S,0),
-            Position + FVector(0,S,0) } 
-        }
-    };
+    OutMin = DirtyMin;
+    OutMax = DirtyMax;
+    DirtyMin = FIntVector(MAX_int32);
+    DirtyMax = FIntVector(MIN_int32);
+    return true;
+}
 
-    int Start = Vertices.Num();
+void AWorldChunk::GenerateVoxels()
+{
+    if (!isInitialized || !WorldManager || !WorldManager->TerrainGenerator) return;
 
-    // Add vertices
-    for (int i = 0; i < 4; ++i)
-    {
-        Vertices.Add(Faces[FaceIndex].Verts[i]);
-        Normals.Add(Faces[FaceIndex].Normal);
-        UVs.Add(FVector2D((i == 1 || i == 2), (i == 2 || i == 3)));
-        VertexColors.Add(FaceColor);
-    }
+    FVoxelStorage NewVoxels;
+    FTerrainColumnField NewColumns;
+    GenerateColumnData(*WorldManager->TerrainGenerator, FIntPoint(ChunkCoords.X, ChunkCoords.Y), ChunkSizeXY, NewColumns);
+    GenerateVoxelData(WorldManager->TerrainGenerator->GetBiomeTable(), NewColumns, ChunkCoords, ChunkSizeXY, ChunkHeightZ, NewVoxels);
+    ApplyVoxelData(MoveTemp(NewVoxels), MoveTemp(NewColumns));
+}
 
-    // Add triangles
-    Triangles.Add(Start + 0);
-    Triangles.Add(Start + 1);
-    Triangles.Add(Start + 2);
+void AWorldChunk::GenerateColumnData(const UTerrainGenerator& TerrainGen, const FIntPoint& ColumnXY, int32 InChunkSizeXY, FTerrainColumnField& OutColumns)
+{
+    const int32 BaseX = ColumnXY.X * InChunkSizeXY;
+    const int32 BaseY = ColumnXY.Y * InChunkSizeXY;
 
-    Triangles.Add(Start + 0);
-    Triangles.Add(Start + 2);
-    Triangles.Add(Start + 3);
+    // Covers the mesher's density padding too: one column on -X/-Y, two on +X/+Y
+    TerrainGen.GenerateColumnField(BaseX - 1, BaseY - 1, InChunkSizeXY + 3, InChunkSizeXY + 3, OutColumns);
 }
 
-void AWorldChunk::GenerateMesh()
+void AWorldChunk::GetSurfaceSections(const FTerrainColumnField& Columns, int32 InChunkHeightZ, int32& OutMinSection, int32& OutMaxSection)
 {
-    if (RenderMode == EVoxelRenderMode::Cubes)
+    if (Columns.IsEmpty())
     {
-        GenerateCubicMesh();
+        OutMinSection = 0;
+        OutMaxSection = -1;
+        return;
     }
-    else if (RenderMode == EVoxelRenderMode::MarchingCubes)
+
+    float MinHeight = Columns.Heights[0];
+    float MaxHeight = Columns.Heights[0];
+
+    for (float Height : Columns.Heights)
     {
-        GenerateMarchingCubesMesh();
+        MinHeight = FMath::Min(MinHeight, Height);
+        MaxHeight = FMath::Max(MaxHeight, Height);
     }
+
+    // One voxel of slack either way: smooth cells reach one lattice point into the next section
+    OutMinSection = FMath::FloorToInt((MinHeight - 1.0f) / InChunkHeightZ);
+    OutMaxSection = FMath::FloorToInt((MaxHeight + 1.0f) / InChunkHeightZ);
 }
 
-void AWorldChunk::GenerateCubicMesh()
+void AWorldChunk::GenerateVoxelData(const FBiomeTable& Biomes, const FTerrainColumnField& Columns, const FIntVector& InChunkCoords, int32 InChunkSizeXY, int32 InChunkHeightZ, FVoxelStorage& OutVoxels)
 {
-    if (Mesh)
-    {
-        Mesh->ClearAllMeshSections();
-    }
+    const int32 BaseX = InChunkCoords.X * InChunkSizeXY;
+    const int32 BaseY = InChunkCoords.Y * InChunkSizeXY;
+    const int32 BaseZ = InChunkCoords.Z * InChunkHeightZ;
 
-    TArray<FVector> Vertices;
-    TArray<int32> Triangles;
-    TArray<FVector> Normals;
-    TArray<FVector2D> UVs;
-	TArray<FColor> VertexColors;
+    OutVoxels.Init(InChunkSizeXY, InChunkHeightZ);
 
-    const int EstimatedFaces = ChunkSizeXY * ChunkSizeXY * ChunkHeightZ;
-    Vertices.Reserve(EstimatedFaces * 6 * 4);
-    Triangles.Reserve(EstimatedFaces * 6 * 6);
-    Normals.Reserve(EstimatedFaces * 6 * 4);
-    UVs.Reserve(EstimatedFaces * 6 * 4);
+    // Filled a brick at a time so uniform bricks are collapsed as they are written
+    const int32 BrickSize = FVoxelStorage::BrickSize;
+    FVoxel Brick[FVoxelStorage::BrickVoxels];
 
-
-    for (int x = 0; x < ChunkSizeXY; x++)
+    for (int32 BZ = 0; BZ < OutVoxels.GetNumBricksZ(); BZ++)
     {
-        for (int y = 0; y < ChunkSizeXY; y++)
+        for (int32 BY = 0; BY < OutVoxels.GetNumBricksXY(); BY++)
         {
-            for (int z = 0; z < ChunkHeightZ; z++)
+            for (int32 BX = 0; BX < OutVoxels.GetNumBricksXY(); BX++)
             {
-                if (!IsVoxelSolidLocal(x, y, z)) continue;
-
-                FVector BasePos = FVector(
-                    x * VoxelScale,
-                    y * VoxelScale,
-                    z * VoxelScale
-                );
-
-                auto NeighborSolid = [&](int NX, int NY, int NZ) -> bool
+                for (int32 LY = 0; LY < BrickSize; LY++)
                 {
-                    int GlobalX = ChunkCoords.X * ChunkSizeXY + NX;
-                    int GlobalY = ChunkCoords.Y * ChunkSizeXY + NY;
-                    int GlobalZ = NZ;
-
-                    if (!WorldManager) return false;
-
-                    FIntPoint NeighborChunkXY;
-                    NeighborChunkXY.X = FMath::FloorToInt((float)GlobalX / ChunkSizeXY);
-                    NeighborChunkXY.Y = FMath::FloorToInt((float)GlobalY / ChunkSizeXY);
-
-                    if (!WorldManager->IsChunkWithinRenderDistance(NeighborChunkXY))
+                    for (int32 LX = 0; LX < BrickSize; LX++)
                     {
-                        return true;
-                    }
+                        const int x = BX * BrickSize + LX;
+                        const int y = BY * BrickSize + LY;
+                        if (x >= InChunkSizeXY || y >= InChunkSizeXY) continue;
 
-                    bool Solid = WorldManager->IsVoxelSolidGlobal(GlobalX, GlobalY, GlobalZ);
+                        const int gx = BaseX + x;
+                        const int gy = BaseY + y;
+                        const float Height = Columns.GetHeight(gx, gy);
+                        const uint8 Biome = Columns.GetBiome(gx, gy);
 
-                    if (x == 0 || x == ChunkSizeXY - 1 || y == 0 || y == ChunkSizeXY - 1)
-                    {
-                        bool LocalSolid = IsVoxelSolidLocal(x, y, z);
-                    }
+                        // Steepest central difference, from the padding columns on the chunk's edges
+                        const float Slope = FMath::Max(
+                            FMath::Abs(Columns.GetHeight(gx + 1, gy) - Columns.GetHeight(gx - 1, gy)),
+                            FMath::Abs(Columns.GetHeight(gx, gy + 1) - Columns.GetHeight(gx, gy - 1))) * 0.5f;
 
-                    return Solid;
-                };
+                        for (int32 LZ = 0; LZ < BrickSize; LZ++)
+                        {
+                            const int z = BZ * BrickSize + LZ;
 
-                int gx = ChunkCoords.X * ChunkSizeXY + x;
-                int gy = ChunkCoords.Y * ChunkSizeXY + y;
+                            FVoxel& Voxel = Brick[LX + LY * BrickSize + LZ * BrickSize * BrickSize];
 
-                EBiomeType Biome = WorldManager->TerrainGenerator->GetDominantBiome(gx, gy);
-                FColor BiomeColor;
+                            float Density = Height - (BaseZ + z);
 
-                switch (Biome)
-                {
-                case EBiomeType::Plains:
-                    BiomeColor = FColor::Green;
-                    break;
-                case EBiomeType::Hills:
-                    BiomeColor = FColor::Blue;
-                    break;
-                case EBiomeType::Mountains:
-                    BiomeColor = FColor::Red;
-                    break;
-                }
-
-                for (int i = 0; i < 4; ++i)
-                {
-					
+                            Voxel.density = Density;
+                            Voxel.isSolid = (Density >= 0.0f);
+                            Voxel.materialID = Voxel.isSolid ? (uint8)Biomes.GetMaterial(Biome, Height, Slope, Density) : 0;
+                        }
+                    }
                 }
 
-                // Check neighbors and add faces if neighbor is empty
-                if (!NeighborSolid(x + 1, y, z)) AddCubeFace(0, BasePos, BiomeColor, Vertices, Triangles, Normals, UVs, VertexColors); // Right
-                if (!NeighborSolid(x - 1, y, z)) AddCubeFace(1, BasePos, BiomeColor, Vertices, Triangles, Normals, UVs, VertexColors); // Left
-                if (!NeighborSolid(x, y + 1, z)) AddCubeFace(2, BasePos, BiomeColor, Vertices, Triangles, Normals, UVs, VertexColors); // Front
-                if (!NeighborSolid(x, y - 1, z)) AddCubeFace(3, BasePos, BiomeColor, Vertices, Triangles, Normals, UVs, VertexColors); // Back
-                if (!NeighborSolid(x, y, z + 1)) AddCubeFace(4, BasePos, BiomeColor, Vertices, Triangles, Normals, UVs, VertexColors); // Top
-
-                if (!ShouldCullBottomFace(x, y, z))
-                {
-                    if (!NeighborSolid(x, y, z - 1)) AddCubeFace(5, BasePos, BiomeColor, Vertices, Triangles, Normals, UVs, VertexColors); // Bottom
-                }
+                OutVoxels.SetBrick(BX, BY, BZ, Brick);
             }
         }
     }
+}
+
+bool AWorldChunk::GenerateColumnRecord(const UTerrainGenerator& TerrainGen, const FIntPoint& ColumnXY, int32 InChunkSizeXY, int32 InChunkHeightZ, FChunkColumnRecord& OutRecord,
+    const std::atomic<bool>* bCancelled)
+{
+    auto IsCancelled = [bCancelled]() { return bCancelled && bCancelled->load(std::memory_order_relaxed); };
 
-    Mesh->CreateMeshSection(0, Vertices, Triangles, Normals, UVs, VertexColors, {}, true);
+    GenerateColumnData(TerrainGen, ColumnXY, InChunkSizeXY, OutRecord.Columns);
+    if (IsCancelled()) return false;
 
-    if (BiomeDebugMaterial)
+    GetSurfaceSections(OutRecord.Columns, InChunkHeightZ, OutRecord.MinSurfaceSection, OutRecord.MaxSurfaceSection);
+
+    OutRecord.Sections.Reset();
+
+    for (int32 SectionZ = OutRecord.MinSurfaceSection; SectionZ <= OutRecord.MaxSurfaceSection; ++SectionZ)
     {
-        Mesh->SetMaterial(0, BiomeDebugMaterial);
+        FChunkSectionVoxels& Section = OutRecord.Sections.AddDefaulted_GetRef();
+        Section.SectionZ = SectionZ;
+        GenerateVoxelData(TerrainGen.GetBiomeTable(), OutRecord.Columns, FIntVector(ColumnXY.X, ColumnXY.Y, SectionZ), InChunkSizeXY, InChunkHeightZ, Section.Voxels);
+        if (IsCancelled()) return false;
     }
+
+    return true;
 }
 
-void AWorldChunk::GenerateMarchingCubesMesh()
+void AWorldChunk::ApplyVoxelData(FVoxelStorage&& InVoxels, FTerrainColumnField&& InColumns)
 {
-    const float IsoLevel = 0.0f;
+    if (!isInitialized || !InVoxels.HasSameSize(ChunkSizeXY, ChunkHeightZ)) return;
 
-    if (Mesh)
+    VoxelData = MoveTemp(InVoxels);
+    ColumnField = MoveTemp(InColumns);
+    bHasVoxels = true;
+    bModified = false;
+    ++VoxelRevision;
+}
+
+FChunkMeshInput AWorldChunk::MakeMeshInput() const
+{
+    FChunkMeshInput Input;
+    Input.ChunkCoords = ChunkCoords;
+    Input.ChunkSizeXY = ChunkSizeXY;
+    Input.ChunkHeightZ = ChunkHeightZ;
+    Input.VoxelScale = VoxelScale;
+    Input.RenderMode = RenderMode;
+    Input.Columns = ColumnField;
+
+    for (int32 Material = 0; Material < (int32)EVoxelMaterial::Num; ++Material)
     {
-        Mesh->ClearAllMeshSections();
+        if (!VoxelMaterials[Material]) Input.DebugColorMaterials |= 1u << Material;
     }
 
-    TArray<FVector> Vertices; Vertices.Reset();
-    TArray<int32> Triangles; Triangles.Reset();
-    TArray<FVector> Normals; Normals.Reset();
-	TArray<FVector2D> UVs; UVs.Reset();
-	TArray<FColor> VertexColors; VertexColors.Reset();
-
-	TMap<FString, int32> VertexIndexMap;
-	VertexIndexMap.Reserve(1024);
+    if (WorldManager)
+    {
+        Input.TerrainGenerator = WorldManager->TerrainGenerator;
+        WorldManager->CaptureChunkBorders(ChunkCoords, Input);
+    }
 
-	TArray<FVector> NormalAcc; NormalAcc.Reset();
+    return Input;
+}
 
-    auto MakeVertexKey = [&](const FVector& Vertex) -> FString
-    {
-		FVector K = Vertex / VoxelScale;
-		K.X = FMath::RoundToFloat(K.X * 100.0f) / 100.0f;
-		K.Y = FMath::RoundToFloat(K.Y * 100.0f) / 100.0f;
-		K.Z = FMath::RoundToFloat(K.Z * 100.0f) / 100.0f;
-
-        return FString::Printf(TEXT("%.2f_%.2f_%.2f"), K.X, K.Y, K.Z);
-	};
-
-	const int32 EstimatedCells = ChunkSizeXY * ChunkSizeXY * ChunkHeightZ;
-    Vertices.Reserve(EstimatedCells * 2);
-    Triangles.Reserve(EstimatedCells * 5);
-	Normals.Reserve(EstimatedCells * 2);
-    NormalAcc.Reserve(EstimatedCells * 2);
-    UVs.Reserve(EstimatedCells * 2);
-
-    for (int x = 0; x < ChunkSizeXY; x++)
-    {
-        for (int y = 0; y < ChunkSizeXY; y++)
-        {
-            for (int z = 0; z < ChunkHeightZ; z++)
-            {
-                int gx = ChunkCoords.X * ChunkSizeXY + x;
-                int gy = ChunkCoords.Y * ChunkSizeXY + y;
-                int gz = z;
-
-                float val[8];
-                FVector pos[8];
-
-                pos[0] = FVector(gx, gy, gz) * VoxelScale - GetActorLocation();
-                pos[1] = FVector(gx + 1, gy, gz) * VoxelScale - GetActorLocation();
-                pos[2] = FVector(gx + 1, gy + 1, gz) * VoxelScale - GetActorLocation();
-                pos[3] = FVector(gx, gy + 1, gz) * VoxelScale - GetActorLocation();
-                pos[4] = FVector(gx, gy, gz + 1) * VoxelScale - GetActorLocation();
-                pos[5] = FVector(gx + 1, gy, gz + 1) * VoxelScale - GetActorLocation();
-                pos[6] = FVector(gx + 1, gy + 1, gz + 1) * VoxelScale - GetActorLocation();
-                pos[7] = FVector(gx, gy + 1, gz + 1) * VoxelScale - GetActorLocation();
-
-                val[0] = SampleDensityAtGlobalVoxel(gx, gy, gz);
-                val[1] = SampleDensityAtGlobalVoxel(gx + 1, gy, gz);
-                val[2] = SampleDensityAtGlobalVoxel(gx + 1, gy + 1, gz);
-                val[3] = SampleDensityAtGlobalVoxel(gx, gy + 1, gz);
-                val[4] = SampleDensityAtGlobalVoxel(gx, gy, gz + 1);
-                val[5] = SampleDensityAtGlobalVoxel(gx + 1, gy, gz + 1);
-                val[6] = SampleDensityAtGlobalVoxel(gx + 1, gy + 1, gz + 1);
-                val[7] = SampleDensityAtGlobalVoxel(gx, gy + 1, gz + 1);
-
-                int cubeIndex = 0;
-
-                if (val[0] > IsoLevel) cubeIndex |= 1;
-                if (val[1] > IsoLevel) cubeIndex |= 2;
-                if (val[2] > IsoLevel) cubeIndex |= 4;
-                if (val[3] > IsoLevel) cubeIndex |= 8;
-                if (val[4] > IsoLevel) cubeIndex |= 16;
-                if (val[5] > IsoLevel) cubeIndex |= 32;
-                if (val[6] > IsoLevel) cubeIndex |= 64;
-                if (val[7] > IsoLevel) cubeIndex |= 128;
-
-                if (MarchingCubeTables::edgeTable[cubeIndex] == 0) continue;
-
-                FVector vertList[12];
-                if (MarchingCubeTables::edgeTable[cubeIndex] &1) vertList[0] = VertexInterp(IsoLevel, pos[0], pos[1], val[0], val[1]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 2) vertList[1] = VertexInterp(IsoLevel, pos[1], pos[2], val[1], val[2]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 4) vertList[2] = VertexInterp(IsoLevel, pos[2], pos[3], val[2], val[3]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 8) vertList[3] = VertexInterp(IsoLevel, pos[3], pos[0], val[3], val[0]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 16) vertList[4] = VertexInterp(IsoLevel, pos[4], pos[5], val[4], val[5]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 32) vertList[5] = VertexInterp(IsoLevel, pos[5], pos[6], val[5], val[6]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 64) vertList[6] = VertexInterp(IsoLevel, pos[6], pos[7], val[6], val[7]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 128) vertList[7] = VertexInterp(IsoLevel, pos[7], pos[4], val[7], val[4]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 256) vertList[8] = VertexInterp(IsoLevel, pos[0], pos[4], val[0], val[4]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 512) vertList[9] = VertexInterp(IsoLevel, pos[1], pos[5], val[1], val[5]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 1024) vertList[10] = VertexInterp(IsoLevel, pos[2], pos[6], val[2], val[6]);
-				if (MarchingCubeTables::edgeTable[cubeIndex] & 2048) vertList[11] = VertexInterp(IsoLevel, pos[3], pos[7], val[3], val[7]);
-
-                for (int i = 0; MarchingCubeTables::triTable[cubeIndex][i] != -1; i += 3)
-                {
-                    int idx0 = MarchingCubeTables::triTable[cubeIndex][i];
-                    int idx1 = MarchingCubeTables::triTable[cubeIndex][i + 1];
-                    int idx2 = MarchingCubeTables::triTable[cubeIndex][i + 2];
+void AWorldChunk::GenerateMesh()
+{
+    if (!isInitialized) return;
 
-                    FVector v0 = vertList[idx0];
-                    FVector v1 = vertList[idx1];
-                    FVector v2 = vertList[idx2];
+    FChunkMeshData MeshData;
+    FChunkMesher(MakeMeshInput(), VoxelData).Build(MeshData);
+    ApplyMeshData(MeshData);
+}
 
-                    auto GetOrCreateVertexIndex = [&](const FVector& Vertex) -> int32
-                    {
-                        FString Key = MakeVertexKey(Vertex);
+void AWorldChunk::ApplyMeshData(const FChunkMeshData& MeshData)
+{
+    if (!Mesh) return;
 
-                        if (VertexIndexMap.Contains(Key))
-                        {
-                            return VertexIndexMap[Key];
-                        }
-                        else
-                        {
-                            int32 NewIndex = Vertices.Add(Vertex);
-                            VertexIndexMap.Add(Key, NewIndex);
-							NormalAcc.Add(FVector::ZeroVector);
-							UVs.Add(FVector2D(Vertex.X / 1000.0f, Vertex.Y / 1000.0f));
-
-                            EBiomeType Biome = WorldManager->TerrainGenerator->GetDominantBiome(gx, gy);
-                            FColor BiomeColor;
-
-                            switch (Biome)
-                            {
-                            case EBiomeType::Plains:
-                                BiomeColor = FColor::Green;
-                                break;
-                            case EBiomeType::Hills:
-                                BiomeColor = FColor::Blue;
-                                break;
-                            case EBiomeType::Mountains:
-                                BiomeColor = FColor::Red;
-                                break;
-                            }
-
-                            VertexColors.Add(BiomeColor);
-
-                            return NewIndex;
-                        }
-					};
+    NumMeshTriangles = MeshData.GetNumTriangles();
+    bHasMesh = true;
 
-					int i0 = GetOrCreateVertexIndex(v0);
-					int i1 = GetOrCreateVertexIndex(v1);
-                    int i2 = GetOrCreateVertexIndex(v2);
+    // Section i always holds voxel material i, so its material only changes when the properties do
+    bool bHasSection[(int32)EVoxelMaterial::Num] = {};
 
-					FVector faceNormal = FVector::CrossProduct(v2 - v0, v1 - v0);
-					faceNormal.Normalize();
+    for (const FChunkMeshSection& Section : MeshData.Sections)
+    {
+        if (Section.Material >= (int32)EVoxelMaterial::Num) continue;
 
-                    Triangles.Add(i0);
-                    Triangles.Add(i1);
-					Triangles.Add(i2);
+        bHasSection[Section.Material] = true;
+        Mesh->CreateMeshSection(Section.Material, Section.Vertices, Section.Triangles, Section.Normals, Section.UVs, Section.VertexColors, {}, bWantsCollision);
 
-                    auto ComputeSmoothNormal = [&](const FVector& V) -> FVector 
-                    {
-                        FVector WorldPos = V + GetActorLocation();
-						float gx = WorldPos.X / VoxelScale;
-						float gy = WorldPos.Y / VoxelScale;
-                        float gz = WorldPos.Z / VoxelScale;
-						return -ComputeGradient(gx, gy, gz);
-                    };
-
-                    NormalAcc[i0] += ComputeSmoothNormal(v0);
-                    NormalAcc[i1] += ComputeSmoothNormal(v1);
-                    NormalAcc[i2] += ComputeSmoothNormal(v2);
-                }
-            }
+        UMaterialInterface* SectionMaterial = GetSectionMaterial(Section.Material);
+        if (SectionMaterial && Mesh->GetMaterial(Section.Material) != SectionMaterial)
+        {
+            Mesh->SetMaterial(Section.Material, SectionMaterial);
         }
     }
 
-	Normals.Init(FVector::ZeroVector, Vertices.Num());
-
-    for (int32 i = 0; i < NormalAcc.Num(); ++i)
+    for (int32 Material = 0; Material < (int32)EVoxelMaterial::Num && Material < Mesh->GetNumSections(); ++Material)
     {
-        FVector Normal = NormalAcc[i].GetSafeNormal();
+        if (!bHasSection[Material]) Mesh->ClearMeshSection(Material);
+    }
 
-        if (!Normal.IsNearlyZero())
-        {
-            Normals[i] = Normal;
-        }
-        else
-        {
-            Normals[i] = FVector::UpVector;
-		}
-	}
+    bMeshHasCollision = bWantsCollision;
+    bCollisionPending = false;
 
-    Mesh->CreateMeshSection(0, Vertices, Triangles, Normals, UVs, VertexColors, {}, true);
+    if (bWantsCollision && NumMeshTriangles > 0)
+    {
+        BeginCollisionCook();
+    }
 
-    if (BiomeDebugMaterial)
+    // A chunk coming out of the pool stays hidden until it has its new mesh, so the old one never shows at the new spot
+    if (IsHidden())
     {
-		Mesh->SetMaterial(0, BiomeDebugMaterial);
+        SetActorHiddenInGame(false);
+        SetActorEnableCollision(true);
     }
 }
 
-FVector AWorldChunk::VertexInterp(float IsoLevel, const FVector& P1, const FVector& P2, float ValP1, float ValP2) const
+UMaterialInterface* AWorldChunk::GetSectionMaterial(int32 Material) const
 {
-    if (FMath::Abs(IsoLevel - ValP1) < KINDA_SMALL_NUMBER)
-        return P1;
-    if (FMath::Abs(IsoLevel - ValP2) < KINDA_SMALL_NUMBER)
-        return P2;
-    if (FMath::Abs(ValP1 - ValP2) < KINDA_SMALL_NUMBER)
-        return P1;
-    float Mu = (IsoLevel - ValP1) / (ValP2 - ValP1);
-    return P1 + Mu * (P2 - P1);
+    return VoxelMaterials[Material] ? VoxelMaterials[Material] : BiomeDebugMaterial;
 }
 
-float AWorldChunk::SampleDensityAtGlobalVoxel(int GlobalX, int GlobalY, int GlobalZ) const
+void AWorldChunk::SetWantsCollision(bool bInWantsCollision)
 {
-    return WorldManager->TerrainGenerator->GetDensity(GlobalX, GlobalY, GlobalZ);
+    if (bWantsCollision == bInWantsCollision) return;
+
+    bWantsCollision = bInWantsCollision;
+
+    if (!Mesh) return;
+
+    Mesh->SetCollisionEnabled(bWantsCollision ? ECollisionEnabled::QueryAndPhysics : ECollisionEnabled::NoCollision);
+
+    if (!bWantsCollision || bMeshHasCollision || !bHasMesh) return;
+
+    // The sections were uploaded without collision while the chunk was out of range; flag them and cook them now
+    for (int32 SectionIndex = 0; SectionIndex < Mesh->GetNumSections(); ++SectionIndex)
+    {
+        const FProcMeshSection* Current = Mesh->GetProcMeshSection(SectionIndex);
+        if (!Current || Current->ProcIndexBuffer.Num() == 0) continue;
+
+        FProcMeshSection Section = *Current;
+        Section.bEnableCollision = true;
+        Mesh->SetProcMeshSection(SectionIndex, Section);
+    }
+
+    bMeshHasCollision = true;
+
+    if (NumMeshTriangles > 0)
+    {
+        BeginCollisionCook();
+    }
 }
 
-FVector AWorldChunk::ComputeGradient(float GX, float GY, float GZ) const
+void AWorldChunk::BeginCollisionCook()
 {
-    const float EPS = 0.5f;
-    float DX = (float)SampleDensityAtGlobalVoxel(GX + EPS, GY, GZ) - (float)SampleDensityAtGlobalVoxel(GX - EPS, GY, GZ);
-    float DY = (float)SampleDensityAtGlobalVoxel(GX, GY + EPS, GZ) - (float)SampleDensityAtGlobalVoxel(GX, GY - EPS, GZ);
-    float DZ = (float)SampleDensityAtGlobalVoxel(GX, GY, GZ + EPS) - (float)SampleDensityAtGlobalVoxel(GX, GY, GZ - EPS);
-
-    return FVector(DX, DY, DZ).GetSafeNormal();
+    // CreateMeshSection and SetProcMeshSection have already queued the cook, leaving the old body setup in place.
+    // A cook queued before this one can finish first and swap too, so readiness may briefly run ahead of the
+    // latest mesh; it never reports ready before any body exists.
+    // Outside a game world the component cooks synchronously and never swaps the body setup
+    const UWorld* World = GetWorld();
+    CookStartBodySetup = Mesh->GetBodySetup();
+    CookStartTime = FPlatformTime::Seconds();
+    bCollisionPending = Mesh->bUseAsyncCooking && World && World->IsGameWorld();
 }
 
-bool AWorldChunk::ShouldCullBottomFace(int X, int Y, int Z) const
+bool AWorldChunk::UpdateCollisionCook()
 {
-    if (Z == 0) return true;
-    return IsVoxelSolidLocal(X, Y, Z - 1);
+    if (!bCollisionPending) return false;
+
+    if (!Mesh || Mesh->GetBodySetup() != CookStartBodySetup.Get())
+    {
+        bCollisionPending = false;
+    }
+    else if (FPlatformTime::Seconds() - CookStartTime > CollisionCookTimeout)
+    {
+        UE_LOG(LogProceduralSurvival, Warning, TEXT("Collision cook for chunk %s did not finish in %.0f s, treating it as done"), *ChunkCoords.ToString(), CollisionCookTimeout);
+        bCollisionPending = false;
+    }
+
+    return bCollisionPending;
 }
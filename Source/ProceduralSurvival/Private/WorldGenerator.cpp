@@ -34,7 +34,7 @@ void AWorldGenerator::BeginPlay()
 
 			if (NewChunk)
 			{
-				NewChunk->InitializeChunk(ChunkSizeXY, ChunkHeightZ, VoxelScale, FIntPoint(x, y));
+				NewChunk->InitializeChunk(ChunkSizeXY, ChunkHeightZ, VoxelScale, FIntVector(x, y, 0));
 			}
 		}
 	}
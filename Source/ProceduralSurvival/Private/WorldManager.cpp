@@ -4,7 +4,55 @@
 #include "WorldManager.h"
 #include "Engine/World.h"
 #include "GameFramework/PlayerController.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "Camera/PlayerCameraManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/Paths.h"
+#include "Misc/Parse.h"
+#include "Misc/CommandLine.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "EngineUtils.h"
+
+DECLARE_STATS_GROUP(TEXT("Voxel World"), STATGROUP_VoxelWorld, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Chunk Mesh Triangles"), STAT_VoxelChunkTriangles, STATGROUP_VoxelWorld);
+DECLARE_MEMORY_STAT(TEXT("Chunk Voxel Memory"), STAT_VoxelChunkMemory, STATGROUP_VoxelWorld);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Chunk Actors"), STAT_VoxelActiveChunks, STATGROUP_VoxelWorld);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pooled Chunk Actors"), STAT_VoxelPooledChunks, STATGROUP_VoxelWorld);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chunk Work Budget (ms)"), STAT_VoxelChunkBudget, STATGROUP_VoxelWorld);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chunk Work Used (ms)"), STAT_VoxelChunkWorkUsed, STATGROUP_VoxelWorld);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Chunk Work Items"), STAT_VoxelChunkWorkItems, STATGROUP_VoxelWorld);
+
+// Columns whose padding a column's mesh reads: the four sides, plus the corners for smooth meshes
+static TArrayView<const FIntPoint> GetMeshNeighborOffsets(EVoxelRenderMode Mode)
+{
+	static const FIntPoint Offsets[8] = {
+		FIntPoint(1, 0),
+		FIntPoint(-1, 0),
+		FIntPoint(0, 1),
+		FIntPoint(0, -1),
+		FIntPoint(1, 1),
+		FIntPoint(-1, 1),
+		FIntPoint(1, -1),
+		FIntPoint(-1, -1)
+	};
+
+	return MakeArrayView(Offsets, Mode == EVoxelRenderMode::MarchingCubes ? 8 : 4);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GRegionLoadBenchmarkCommand(
+	TEXT("voxel.BenchmarkRegionLoad"),
+	TEXT("Times loading the chunk columns around the player from regeneration, buffered region reads and mapped region reads. Argument: radius in columns (default 8, i.e. 17x17)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Radius = Args.Num() > 0 ? FMath::Max(0, FCString::Atoi(*Args[0])) : 8;
+
+		for (TActorIterator<AWorldManager> It(World); It; ++It)
+		{
+			It->RunRegionLoadBenchmark(Radius);
+			break;
+		}
+	}));
 
 // Sets default values
 AWorldManager::AWorldManager()
@@ -13,6 +61,7 @@ AWorldManager::AWorldManager()
 	PrimaryActorTick.bCanEverTick = true;
 
 	TerrainGenerator = CreateDefaultSubobject<UTerrainGenerator>(TEXT("TerrainGenerator"));
+	FarFieldClass = AFarFieldTerrain::StaticClass();
 }
 
 // Called when the game starts or when spawned
@@ -30,6 +79,49 @@ void AWorldManager::BeginPlay()
 		return;
 	}
 
+	ChunkPipeline = MakeUnique<FChunkPipeline>();
+	ChunkPipeline->SetMaxInFlight(MaxChunkJobsInFlight);
+
+	ChunkBudgetMs = ChunkWorkBudgetMs;
+
+	// Rough starting costs, replaced by measurements within a few frames
+	ChunkWorkCostMs[(int32)EChunkWorkKind::ApplyColumn] = 0.5f;
+	ChunkWorkCostMs[(int32)EChunkWorkKind::ApplyMesh] = 0.5f;
+	ChunkWorkCostMs[(int32)EChunkWorkKind::ApplyFarFieldTile] = 0.5f;
+	ChunkWorkCostMs[(int32)EChunkWorkKind::DispatchRemesh] = 0.1f;
+	ChunkWorkCostMs[(int32)EChunkWorkKind::DispatchJob] = 0.01f;
+
+	// Server shards pick their world with -TerrainSeed=N
+	int32 SeedOverride = 0;
+	if (TerrainGenerator && FParse::Value(FCommandLine::Get(), TEXT("TerrainSeed="), SeedOverride))
+	{
+		TerrainGenerator->SetSeed(SeedOverride);
+	}
+
+	if (bSaveChunks)
+	{
+		// Saved columns only fit the seed they were generated with. Seed 0 keeps the folder worlds had before seeds.
+		FString Folder = RegionFolder;
+		if (TerrainGenerator && TerrainGenerator->Seed != 0)
+		{
+			Folder += FString::Printf(TEXT("_Seed%d"), TerrainGenerator->Seed);
+		}
+
+		RegionStore = MakeUnique<FRegionStore>(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Regions"), Folder), ChunkSizeXY, ChunkHeightZ);
+	}
+
+	if (bEnableFarField && FarFieldClass && FarFieldDistance > RenderDistance)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		FarField = GetWorld()->SpawnActor<AFarFieldTerrain>(FarFieldClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+
+		if (FarField)
+		{
+			FarField->Configure(ChunkSizeXY, VoxelScale, RenderDistance, FarFieldDistance);
+		}
+	}
+
 	PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
 
 	// Initialize CenterChunk based on player position
@@ -40,11 +132,40 @@ void AWorldManager::BeginPlay()
 		FIntVector GV = WorldPosToGlobalVoxel(PlayerPos);
 		CenterChunk.X = FMath::FloorToInt((float)GV.X / ChunkSizeXY);
 		CenterChunk.Y = FMath::FloorToInt((float)GV.Y / ChunkSizeXY);
+
+		SetPawnHeld(bHoldPawnUntilCollision);
 	}
 
 	UpdateChunks();
 }
 
+void AWorldManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Workers read TerrainGenerator and the region store, so they must be finished before either can go away
+	if (ChunkPipeline)
+	{
+		ChunkPipeline->Shutdown();
+		ChunkPipeline.Reset();
+	}
+
+	// Columns still loaded are saved too; the store waits for its writes when it is destroyed
+	for (const auto& Pair : ActiveColumns)
+	{
+		SaveColumnToRegion(Pair.Key, Pair.Value);
+	}
+	RegionStore.Reset();
+
+	SetPawnHeld(false);
+
+	if (FarField)
+	{
+		FarField->Destroy();
+		FarField = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void AWorldManager::Tick(float DeltaTime)
 {
@@ -64,51 +185,502 @@ void AWorldManager::Tick(float DeltaTime)
 		UpdateChunks();
 	}
 
-	if (ChunkGenQueue.Num() > 0)
+	if (!ChunkPipeline) return;
+
+	BeginChunkWork(DeltaTime);
+
+	ProcessCompletedChunkJobs();
+	PollCollisionCooks();
+
+#if STATS
+	// "stat VoxelWorld" shows the triangle cost of the current RenderMode, e.g. Cubes against GreedyCubes
+	int32 TotalTriangles = 0;
+	SIZE_T TotalVoxelMemory = 0;
+	for (const auto& Pair : ActiveChunks)
 	{
+		if (!Pair.Value) continue;
+
+		TotalTriangles += Pair.Value->GetNumMeshTriangles();
+		TotalVoxelMemory += Pair.Value->GetVoxelData().GetAllocatedSize();
+	}
+	SET_DWORD_STAT(STAT_VoxelChunkTriangles, TotalTriangles);
+	SET_MEMORY_STAT(STAT_VoxelChunkMemory, TotalVoxelMemory);
+	SET_DWORD_STAT(STAT_VoxelActiveChunks, ActiveChunks.Num());
+	SET_DWORD_STAT(STAT_VoxelPooledChunks, ChunkPool.Num());
+#endif
+
+	FlushVoxelEdits();
 
-		ChunkGenAccumulator += DeltaTime * ChunkGenRate;
+	// Edits first, then seam fixes for chunks already on screen, then new chunks
+	DispatchRemeshJobs(EditRemeshQueue);
+	DispatchRemeshJobs(ChunkRemeshQueue);
+	DispatchGenerateJobs();
 
-		int32 NumToProcess = FMath::FloorToInt(ChunkGenAccumulator);
+	// The horizon fills in once the voxel terrain has nothing left to do
+	if (ChunkGenQueue.Num() == 0 && EditRemeshQueue.Num() == 0 && ChunkRemeshQueue.Num() == 0)
+	{
+		DispatchFarFieldJobs();
+	}
+
+	SET_FLOAT_STAT(STAT_VoxelChunkBudget, ChunkBudgetMs);
+	SET_FLOAT_STAT(STAT_VoxelChunkWorkUsed, (FPlatformTime::Seconds() - ChunkWorkStartSeconds) * 1000.0);
+	SET_DWORD_STAT(STAT_VoxelChunkWorkItems, NumChunkWorkItems);
+}
 
-		if (NumToProcess > 0)
+void AWorldManager::BeginChunkWork(float DeltaTime)
+{
+	if (!bAdaptiveChunkBudget)
+	{
+		ChunkBudgetMs = ChunkWorkBudgetMs;
+	}
+	else if (DeltaTime * 1000.0f > TargetFrameTimeMs * 1.05f)
+	{
+		// Back off quickly after a long frame and creep back up while frames are on target. Frame time includes
+		// waiting for vsync, so at a capped frame rate the budget grows until frames start to run long.
+		ChunkBudgetMs *= 0.75f;
+	}
+	else
+	{
+		ChunkBudgetMs += 0.1f;
+	}
+
+	if (bAdaptiveChunkBudget)
+	{
+		ChunkBudgetMs = FMath::Clamp(ChunkBudgetMs, MinChunkWorkBudgetMs, FMath::Max(MinChunkWorkBudgetMs, MaxChunkWorkBudgetMs));
+	}
+
+	ChunkWorkStartSeconds = FPlatformTime::Seconds();
+	NumChunkWorkItems = 0;
+}
+
+bool AWorldManager::HasChunkBudgetFor(EChunkWorkKind Kind) const
+{
+	if (NumChunkWorkItems == 0) return true;
+
+	const double UsedMs = (FPlatformTime::Seconds() - ChunkWorkStartSeconds) * 1000.0;
+	return UsedMs + ChunkWorkCostMs[(int32)Kind] <= ChunkBudgetMs;
+}
+
+void AWorldManager::RecordChunkWork(EChunkWorkKind Kind, double StartSeconds)
+{
+	const float CostMs = (float)((FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+
+	float& Average = ChunkWorkCostMs[(int32)Kind];
+	Average = FMath::Lerp(Average, CostMs, 0.2f);
+
+	++NumChunkWorkItems;
+}
+
+void AWorldManager::DispatchGenerateJobs()
+{
+	while (ChunkGenQueue.Num() > 0 && ChunkPipeline->GetNumFreeSlots() > 0 && HasChunkBudgetFor(EChunkWorkKind::DispatchJob))
+	{
+		const double Start = FPlatformTime::Seconds();
+
+		FChunkGenRequest Request;
+		ChunkGenQueue.HeapPop(Request, EAllowShrinking::No);
+
+		const FIntPoint ColumnXY = Request.ColumnXY;
+		const FChunkColumn* Column = ActiveColumns.Find(ColumnXY);
+
+		if (Column && !Column->bGenerated && !ChunkPipeline->IsInFlight(FChunkBuildJob::ColumnKey(ColumnXY)))
 		{
-			ChunkGenAccumulator -= NumToProcess;
+			DispatchGenerateJob(ColumnXY);
+		}
 
-			NumToProcess = FMath::Min(NumToProcess, ChunkGenQueue.Num());
+		RecordChunkWork(EChunkWorkKind::DispatchJob, Start);
+	}
+}
 
-			SortChunkQueueByDistance();
+void AWorldManager::DispatchGenerateJob(const FIntPoint& ColumnXY)
+{
+	TSharedRef<FChunkBuildJob> Job = MakeShared<FChunkBuildJob>();
+	Job->Type = EChunkJobType::GenerateColumn;
+	Job->ChunkCoords = FChunkBuildJob::ColumnKey(ColumnXY);
+	Job->MeshInput.ChunkCoords = FIntVector(ColumnXY.X, ColumnXY.Y, 0);
+	Job->MeshInput.ChunkSizeXY = ChunkSizeXY;
+	Job->MeshInput.ChunkHeightZ = ChunkHeightZ;
+	Job->MeshInput.VoxelScale = VoxelScale;
+	Job->MeshInput.TerrainGenerator = TerrainGenerator;
+	Job->RegionStore = RegionStore.Get();
 
-			for (int32 i = 0; i < NumToProcess; ++i)
-			{
-				FIntPoint ChunkXY = ChunkGenQueue[0];
-				ChunkGenQueue.RemoveAt(0);
-				AWorldChunk** ChunkPtr = ActiveChunks.Find(ChunkXY);
+	ChunkPipeline->Dispatch(Job);
+}
+
+void AWorldManager::DispatchFarFieldJobs()
+{
+	if (!FarField || !TerrainGenerator) return;
+
+	while (ChunkPipeline->GetNumFreeSlots() > 0 && HasChunkBudgetFor(EChunkWorkKind::DispatchJob))
+	{
+		const double Start = FPlatformTime::Seconds();
+
+		FFarFieldTile Tile;
+		if (!FarField->PopPendingTile(Tile)) break;
 
-				if (ChunkPtr && *ChunkPtr)
+		TSharedRef<FChunkBuildJob> Job = MakeShared<FChunkBuildJob>();
+		Job->Type = EChunkJobType::FarFieldTile;
+		Job->ChunkCoords = FChunkBuildJob::FarFieldKey(Tile.TileXY);
+		Job->MeshInput.TerrainGenerator = TerrainGenerator;
+		Job->FarFieldTile = Tile;
+
+		ChunkPipeline->Dispatch(Job);
+		RecordChunkWork(EChunkWorkKind::DispatchJob, Start);
+	}
+}
+
+void AWorldManager::DispatchRemeshJobs(TSet<FIntVector>& Queue)
+{
+	if (Queue.Num() == 0) return;
+
+	TArray<FIntVector> Dispatched;
+
+	for (const FIntVector& ChunkCoords : Queue)
+	{
+		if (ChunkPipeline->GetNumFreeSlots() <= 0 || !HasChunkBudgetFor(EChunkWorkKind::DispatchRemesh)) break;
+
+		AWorldChunk** ChunkPtr = ActiveChunks.Find(ChunkCoords);
+		AWorldChunk* Chunk = ChunkPtr ? *ChunkPtr : nullptr;
+
+		if (!Chunk)
+		{
+			Dispatched.Add(ChunkCoords);
+			continue;
+		}
+
+		// A running mesh job would be cancelled by a new one; wait for it and rebuild afterwards
+		if (!Chunk->HasVoxels() || ChunkPipeline->IsInFlight(ChunkCoords)) continue;
+
+		const double Start = FPlatformTime::Seconds();
+
+		TSharedRef<FChunkBuildJob> Job = MakeShared<FChunkBuildJob>();
+		Job->ChunkCoords = ChunkCoords;
+		Job->Chunk = Chunk;
+		Job->VoxelRevision = Chunk->GetVoxelRevision();
+		Job->MeshInput = Chunk->MakeMeshInput();
+		Job->Voxels = Chunk->GetVoxelData();
+
+		ChunkPipeline->Dispatch(Job);
+		Dispatched.Add(ChunkCoords);
+
+		RecordChunkWork(EChunkWorkKind::DispatchRemesh, Start);
+	}
+
+	// One build covers a chunk waiting in both queues
+	for (const FIntVector& ChunkCoords : Dispatched)
+	{
+		EditRemeshQueue.Remove(ChunkCoords);
+		ChunkRemeshQueue.Remove(ChunkCoords);
+	}
+}
+
+void AWorldManager::MarkChunkEdited(const FIntVector& ChunkCoords)
+{
+	EditedChunks.Add(ChunkCoords);
+}
+
+void AWorldManager::FlushVoxelEdits()
+{
+	if (EditedChunks.Num() == 0) return;
+
+	// Lowest local coordinate the neighbour on the low side of an axis reads. Cube borders are one voxel deep;
+	// smooth meshes also read a second padding layer on the high side, which is the low neighbour's 1.
+	const bool bSmooth = RenderMode == EVoxelRenderMode::MarchingCubes;
+	const int32 LowMargin = bSmooth ? 1 : 0;
+	const FIntVector Size(ChunkSizeXY, ChunkSizeXY, ChunkHeightZ);
+
+	TArray<FIntVector> Edited = EditedChunks.Array();
+	EditedChunks.Reset();
+
+	for (const FIntVector& ChunkCoords : Edited)
+	{
+		AWorldChunk** ChunkPtr = ActiveChunks.Find(ChunkCoords);
+		AWorldChunk* Chunk = ChunkPtr ? *ChunkPtr : nullptr;
+
+		FIntVector DirtyMin;
+		FIntVector DirtyMax;
+		if (!Chunk || !Chunk->ConsumeDirtyBox(DirtyMin, DirtyMax)) continue;
+
+		EditRemeshQueue.Add(ChunkCoords);
+
+		// Face neighbours on all axes; horizontal diagonals only for smooth meshes, whose padding has corners
+		for (int32 DZ = -1; DZ <= 1; ++DZ)
+		{
+			for (int32 DY = -1; DY <= 1; ++DY)
+			{
+				for (int32 DX = -1; DX <= 1; ++DX)
 				{
-					(*ChunkPtr)->GenerateVoxels();
-					(*ChunkPtr)->GenerateMesh();
-					OnChunkCreated(ChunkXY);
+					const FIntVector Offset(DX, DY, DZ);
+					const int32 NumAxes = FMath::Abs(DX) + FMath::Abs(DY) + FMath::Abs(DZ);
+
+					if (NumAxes == 0 || (DZ != 0 && NumAxes > 1) || (NumAxes > 1 && !bSmooth)) continue;
+
+					bool bTouchesBorder = true;
+					for (int32 Axis = 0; Axis < 3 && bTouchesBorder; ++Axis)
+					{
+						if (Offset[Axis] < 0) bTouchesBorder = DirtyMin[Axis] <= LowMargin;
+						if (Offset[Axis] > 0) bTouchesBorder = DirtyMax[Axis] >= Size[Axis] - 1;
+					}
+
+					if (!bTouchesBorder) continue;
+
+					const FIntVector NeighborCoords = ChunkCoords + Offset;
+
+					if (FindChunkWithVoxels(NeighborCoords))
+					{
+						EditRemeshQueue.Add(NeighborCoords);
+					}
+					else if (IsSectionBelowSurface(NeighborCoords))
+					{
+						// A solid section without an actor has no faces to show where the edit opened it up
+						FindOrMaterializeChunk(NeighborCoords);
+					}
 				}
 			}
 		}
 	}
 }
 
-void AWorldManager::SortChunkQueueByDistance()
+bool AWorldManager::SetVoxelGlobal(int GlobalVoxelX, int GlobalVoxelY, int GlobalVoxelZ, bool bSolid)
 {
-	if (!PlayerPawn) return;
+	FIntVector ChunkCoords;
+	FIntVector LocalXYZ;
+	GlobalVoxelToChunkCoords(GlobalVoxelX, GlobalVoxelY, GlobalVoxelZ, ChunkCoords, LocalXYZ);
 
-	FVector PlayerPos = PlayerPawn->GetActorLocation();
+	if (IsVoxelSolidGlobal(GlobalVoxelX, GlobalVoxelY, GlobalVoxelZ) == bSolid) return false;
+
+	AWorldChunk* Chunk = FindOrMaterializeChunk(ChunkCoords);
+	if (!Chunk) return false;
+
+	Chunk->SetVoxelLocal(LocalXYZ.X, LocalXYZ.Y, LocalXYZ.Z, bSolid);
+	return true;
+}
+
+int32 AWorldManager::SetVoxelsInSphere(const FVector& CenterWorld, float RadiusVoxels, bool bSolid)
+{
+	if (RadiusVoxels <= 0.0f) return 0;
+
+	const FVector Center = CenterWorld / VoxelScale;
+	const FIntVector Min(FMath::FloorToInt(Center.X - RadiusVoxels), FMath::FloorToInt(Center.Y - RadiusVoxels), FMath::FloorToInt(Center.Z - RadiusVoxels));
+	const FIntVector Max(FMath::CeilToInt(Center.X + RadiusVoxels), FMath::CeilToInt(Center.Y + RadiusVoxels), FMath::CeilToInt(Center.Z + RadiusVoxels));
+	const double RadiusSquared = FMath::Square((double)RadiusVoxels);
+
+	int32 NumChanged = 0;
+
+	for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			for (int32 X = Min.X; X <= Max.X; ++X)
+			{
+				if (FVector::DistSquared(FVector(X + 0.5, Y + 0.5, Z + 0.5), Center) > RadiusSquared) continue;
+
+				NumChanged += SetVoxelGlobal(X, Y, Z, bSolid) ? 1 : 0;
+			}
+		}
+	}
+
+	return NumChanged;
+}
+
+AWorldChunk* AWorldManager::FindOrMaterializeChunk(const FIntVector& ChunkCoords)
+{
+	if (AWorldChunk** Found = ActiveChunks.Find(ChunkCoords))
+	{
+		return *Found;
+	}
+
+	FChunkColumn* Column = ActiveColumns.Find(FIntPoint(ChunkCoords.X, ChunkCoords.Y));
+	if (!Column || !Column->bGenerated) return nullptr;
+
+	// Keeps a stray edit far above or below the terrain from spawning a tower of empty sections
+	static constexpr int32 MaxColumnSections = 64;
+
+	const int32 NewMin = FMath::Min(Column->MinSurfaceSection, ChunkCoords.Z);
+	const int32 NewMax = FMath::Max(Column->MaxSurfaceSection, ChunkCoords.Z);
+	if (NewMax - NewMin + 1 > MaxColumnSections) return nullptr;
+
+	// The field is the same for every section of the column, so copy it from one that has it
+	const AWorldChunk* Source = nullptr;
+	for (int32 SectionZ = Column->MinSurfaceSection; SectionZ <= Column->MaxSurfaceSection && !Source; ++SectionZ)
+	{
+		Source = FindChunkWithVoxels(FIntVector(ChunkCoords.X, ChunkCoords.Y, SectionZ));
+	}
+
+	if (!Source) return nullptr;
+
+	const FTerrainColumnField Columns = Source->GetColumnField();
+
+	auto Materialize = [&](int32 SectionZ) -> AWorldChunk*
+	{
+		const FIntVector SectionCoords(ChunkCoords.X, ChunkCoords.Y, SectionZ);
+		AWorldChunk* Chunk = RegisterChunkAt(SectionCoords);
+		if (!Chunk) return nullptr;
+
+		FVoxelStorage Voxels;
+		AWorldChunk::GenerateVoxelData(TerrainGenerator ? TerrainGenerator->GetBiomeTable() : FBiomeTable::GetDefault(), Columns, SectionCoords, ChunkSizeXY, ChunkHeightZ, Voxels);
+
+		FTerrainColumnField SectionColumns = Columns;
+		Chunk->ApplyVoxelData(MoveTemp(Voxels), MoveTemp(SectionColumns));
+		EditRemeshQueue.Add(SectionCoords);
+		return Chunk;
+	};
+
+	// Grow the range one section at a time so it stays contiguous even if a spawn fails
+	AWorldChunk* Chunk = nullptr;
+
+	for (int32 SectionZ = Column->MinSurfaceSection - 1; SectionZ >= NewMin; --SectionZ)
+	{
+		Chunk = Materialize(SectionZ);
+		if (!Chunk) return nullptr;
+
+		Column->MinSurfaceSection = SectionZ;
+		Column->bNeedsSave = true;
+	}
+
+	for (int32 SectionZ = Column->MaxSurfaceSection + 1; SectionZ <= NewMax; ++SectionZ)
+	{
+		Chunk = Materialize(SectionZ);
+		if (!Chunk) return nullptr;
+
+		Column->MaxSurfaceSection = SectionZ;
+		Column->bNeedsSave = true;
+	}
+
+	return Chunk;
+}
+
+void AWorldManager::ProcessCompletedChunkJobs()
+{
+	// Results past the budget stay queued, holding their pipeline slots, until a later frame has time for them
+	while (const FChunkBuildJob* Next = ChunkPipeline->PeekCompleted())
+	{
+		const EChunkWorkKind Kind =
+			Next->Type == EChunkJobType::GenerateColumn ? EChunkWorkKind::ApplyColumn :
+			Next->Type == EChunkJobType::FarFieldTile ? EChunkWorkKind::ApplyFarFieldTile :
+			EChunkWorkKind::ApplyMesh;
+
+		if (!HasChunkBudgetFor(Kind)) break;
+
+		const double Start = FPlatformTime::Seconds();
+
+		TSharedPtr<FChunkBuildJob> Job;
+		if (!ChunkPipeline->PopCompleted(Job)) break;
+
+		ApplyCompletedJob(*Job);
+		RecordChunkWork(Kind, Start);
+	}
+}
+
+void AWorldManager::ApplyCompletedJob(FChunkBuildJob& Job)
+{
+	if (Job.Type == EChunkJobType::GenerateColumn)
+	{
+		ApplyColumnJob(Job);
+		return;
+	}
+
+	if (Job.Type == EChunkJobType::FarFieldTile)
+	{
+		if (FarField)
+		{
+			FarField->ApplyTileMesh(Job.FarFieldTile, Job.MeshData);
+		}
+		return;
+	}
+
+	AWorldChunk** ChunkPtr = ActiveChunks.Find(Job.ChunkCoords);
+	AWorldChunk* Chunk = Job.Chunk.Get();
+
+	// The chunk left range or was replaced while the job was running
+	if (!Chunk || !ChunkPtr || *ChunkPtr != Chunk) return;
+
+	if (Job.VoxelRevision != Chunk->GetVoxelRevision())
+	{
+		// Voxels were edited after the copy was taken, so this mesh is already out of date
+		EditRemeshQueue.Add(Job.ChunkCoords);
+		return;
+	}
+
+	Chunk->ApplyMeshData(Job.MeshData);
+
+	if (Chunk->IsCollisionPending())
+	{
+		CollisionCookingChunks.Add(Job.ChunkCoords);
+	}
+}
+
+void AWorldManager::ApplyColumnJob(FChunkBuildJob& Job)
+{
+	const FIntPoint ColumnXY(Job.ChunkCoords.X, Job.ChunkCoords.Y);
+	FChunkColumn* Column = ActiveColumns.Find(ColumnXY);
+
+	// The column left range while the job was running
+	if (!Column || Column->bGenerated) return;
+
+	Column->bGenerated = true;
+	Column->MinSurfaceSection = Job.MinSurfaceSection;
+	Column->MaxSurfaceSection = Job.MaxSurfaceSection;
+	Column->bNeedsSave = !Job.bLoadedFromDisk;
+
+	// Meshing waits for OnColumnGenerated to find the neighbours ready
+	for (FChunkSectionVoxels& Section : Job.Sections)
+	{
+		const FIntVector ChunkCoords(ColumnXY.X, ColumnXY.Y, Section.SectionZ);
+		AWorldChunk* Chunk = RegisterChunkAt(ChunkCoords);
+		if (!Chunk) continue;
+
+		FTerrainColumnField Columns = Job.MeshInput.Columns;
+		Chunk->ApplyVoxelData(MoveTemp(Section.Voxels), MoveTemp(Columns));
+	}
+
+	OnColumnGenerated(ColumnXY);
+}
+
+void AWorldManager::ReprioritizeChunkQueue()
+{
+	if (ChunkGenQueue.Num() == 0) return;
 
 	const float ChunkWorldSize = ChunkSizeXY * VoxelScale;
 
-	ChunkGenQueue.Sort([&](const FIntPoint& A, const FIntPoint& B) {
-		FVector PosA = FVector(A.X * ChunkWorldSize, A.Y * ChunkWorldSize, 0.0f);
-		FVector PosB = FVector(B.X * ChunkWorldSize, B.Y * ChunkWorldSize, 0.0f);
-		return FVector::DistSquared(PosA, PlayerPos) < FVector::DistSquared(PosB, PlayerPos);
-	});
+	// Distance is taken from where the player is heading, not where they stand
+	FVector2D Origin = FVector2D::ZeroVector;
+	if (PlayerPawn)
+	{
+		Origin = FVector2D(PlayerPawn->GetActorLocation() + PlayerPawn->GetVelocity() * ChunkLookAheadTime);
+	}
+
+	// Visibility is a horizontal cone test against the camera; without a camera every column counts as visible
+	FVector2D ViewLocation = Origin;
+	FVector2D ViewForward = FVector2D::ZeroVector;
+	float CosHalfFov = -1.0f;
+
+	const APlayerController* PlayerController = UGameplayStatics::GetPlayerController(GetWorld(), 0);
+	if (PlayerController && PlayerController->PlayerCameraManager)
+	{
+		const APlayerCameraManager* Camera = PlayerController->PlayerCameraManager;
+		ViewLocation = FVector2D(Camera->GetCameraLocation());
+		ViewForward = FVector2D(Camera->GetCameraRotation().Vector()).GetSafeNormal();
+		CosHalfFov = FMath::Cos(FMath::DegreesToRadians(Camera->GetFOVAngle() * 0.5f));
+	}
+
+	for (FChunkGenRequest& Request : ChunkGenQueue)
+	{
+		const FVector2D Center = (FVector2D(Request.ColumnXY) + 0.5f) * ChunkWorldSize;
+
+		Request.Priority = FVector2D::Distance(Center, Origin);
+
+		// The column the camera stands in is always in view
+		const FVector2D ToColumn = Center - ViewLocation;
+		const bool bInView = ViewForward.IsZero() || ToColumn.Size() < ChunkWorldSize || FVector2D::DotProduct(ToColumn.GetSafeNormal(), ViewForward) >= CosHalfFov;
+
+		if (!bInView)
+		{
+			Request.Priority *= OutOfViewPriorityScale;
+		}
+	}
+
+	ChunkGenQueue.Heapify();
 }
 
 FIntVector AWorldManager::WorldPosToGlobalVoxel(const FVector& WorldPos) const
@@ -121,34 +693,48 @@ FIntVector AWorldManager::WorldPosToGlobalVoxel(const FVector& WorldPos) const
 	return GV;
 }
 
-void AWorldManager::GlobalVoxelToChunkCoords(int GlobalX, int GlobalY, int GlobalZ, FIntPoint& OutChunkXY, FIntVector& OutLocalXYZ) const
+void AWorldManager::GlobalVoxelToChunkCoords(int GlobalX, int GlobalY, int GlobalZ, FIntVector& OutChunkXYZ, FIntVector& OutLocalXYZ) const
 {
 	int ChunkX = FMath::FloorToInt((float)GlobalX / ChunkSizeXY);
 	int ChunkY = FMath::FloorToInt((float)GlobalY / ChunkSizeXY);
+	int ChunkZ = FMath::FloorToInt((float)GlobalZ / ChunkHeightZ);
 
 	int LocalX = GlobalX - ChunkX * ChunkSizeXY;
 	int LocalY = GlobalY - ChunkY * ChunkSizeXY;
-	int LocalZ = GlobalZ;
+	int LocalZ = GlobalZ - ChunkZ * ChunkHeightZ;
 
-	OutChunkXY = FIntPoint(ChunkX, ChunkY);
+	OutChunkXYZ = FIntVector(ChunkX, ChunkY, ChunkZ);
 	OutLocalXYZ = FIntVector(LocalX, LocalY, LocalZ);
 }
 
 bool AWorldManager::IsVoxelSolidGlobal(int GlobalVoxelX, int GlobalVoxelY, int GlobalVoxelZ) const
 {
-	FIntPoint ChunkXY;
+	FIntVector ChunkCoords;
 	FIntVector LocalXYZ;
-	GlobalVoxelToChunkCoords(GlobalVoxelX, GlobalVoxelY, GlobalVoxelZ, ChunkXY, LocalXYZ);
+	GlobalVoxelToChunkCoords(GlobalVoxelX, GlobalVoxelY, GlobalVoxelZ, ChunkCoords, LocalXYZ);
 
-	AWorldChunk* const* ChunkPtr = ActiveChunks.Find(ChunkXY);
+	AWorldChunk* const* ChunkPtr = ActiveChunks.Find(ChunkCoords);
 
-	if (!ChunkPtr || !(*ChunkPtr)) return false;
+	// Sections without a chunk are stored as the column's surface range only
+	if (!ChunkPtr || !(*ChunkPtr)) return IsSectionBelowSurface(ChunkCoords);
 
-	const AWorldChunk* Chunk = *ChunkPtr;
+	return (*ChunkPtr)->IsVoxelSolidLocal(LocalXYZ.X, LocalXYZ.Y, LocalXYZ.Z);
+}
+
+const AWorldChunk* AWorldManager::FindChunkWithVoxels(const FIntVector& ChunkCoords) const
+{
+	AWorldChunk* const* ChunkPtr = ActiveChunks.Find(ChunkCoords);
+	const AWorldChunk* Chunk = ChunkPtr ? *ChunkPtr : nullptr;
 
-	if (LocalXYZ.Z < 0 || LocalXYZ.Z >= Chunk->GetChunkHeightZ()) return false;
+	if (!Chunk || !Chunk->HasVoxels() || !Chunk->GetVoxelData().HasSameSize(ChunkSizeXY, ChunkHeightZ)) return nullptr;
 
-	return Chunk->IsVoxelSolidLocal(LocalXYZ.X, LocalXYZ.Y, LocalXYZ.Z);
+	return Chunk;
+}
+
+bool AWorldManager::IsSectionBelowSurface(const FIntVector& ChunkCoords) const
+{
+	const FChunkColumn* Column = ActiveColumns.Find(FIntPoint(ChunkCoords.X, ChunkCoords.Y));
+	return Column && Column->bGenerated && ChunkCoords.Z < Column->MinSurfaceSection;
 }
 
 void AWorldManager::UpdateChunks()
@@ -159,89 +745,277 @@ void AWorldManager::UpdateChunks()
 		return;
 	}
 
-	// Determine which chunks should be active
-	TSet<FIntPoint> DesiredChunks;
-	TArray<FIntPoint> ChunksToSpawn;
-	ChunksToSpawn.Empty();
+	// Determine which columns should be active. Their sections are spawned once the column job reports
+	// where the surface is.
+	TSet<FIntPoint> DesiredColumns;
 
 	for (int DX = -RenderDistance; DX <= RenderDistance; ++DX)
 	{
 		for (int DY = -RenderDistance; DY <= RenderDistance; ++DY)
 		{
-			FIntPoint ChunkXY = FIntPoint(CenterChunk.X + DX, CenterChunk.Y + DY);
-			DesiredChunks.Add(ChunkXY);
+			FIntPoint ColumnXY = FIntPoint(CenterChunk.X + DX, CenterChunk.Y + DY);
+			DesiredColumns.Add(ColumnXY);
 
-			if (!ActiveChunks.Contains(ChunkXY))
+			if (!ActiveColumns.Contains(ColumnXY))
 			{
-				RegisterChunkAt(ChunkXY);
+				ActiveColumns.Add(ColumnXY, FChunkColumn());
 
-				ChunkGenQueue.Add(ChunkXY);
+				ChunkGenQueue.Add({ ColumnXY, 0.0f });
 			}
 		}
 	}
 
-	// Destroy chunks that are no longer needed
-	TArray<FIntPoint> ChunksToRemove;
+	// Destroy columns that are no longer needed
+	TArray<FIntPoint> ColumnsToRemove;
 
-	for (auto& Pair : ActiveChunks)
+	for (auto& Pair : ActiveColumns)
 	{
-		if (!DesiredChunks.Contains(Pair.Key))
+		if (!DesiredColumns.Contains(Pair.Key))
 		{
-			ChunksToRemove.Add(Pair.Key);
+			ColumnsToRemove.Add(Pair.Key);
 		}
 	}
 
-	for (const FIntPoint& ChunkXY : ChunksToRemove)
+	for (const FIntPoint& ColumnXY : ColumnsToRemove)
+	{
+		DestroyColumnAt(ColumnXY);
+	}
+
+	ChunkGenQueue.RemoveAll([&](const FChunkGenRequest& Request) { return !ActiveColumns.Contains(Request.ColumnXY); });
+	ReprioritizeChunkQueue();
+	UpdateLodStrides();
+	UpdateCollisionRange();
+
+	if (FarField)
 	{
-		DestroyChunkAt(ChunkXY);
+		FarField->SetCenter(CenterChunk);
 	}
 
-	UE_LOG(LogTemp, Warning, TEXT("Active chunks: %d"), ActiveChunks.Num());
+	UE_LOG(LogTemp, Warning, TEXT("Active chunks: %d in %d columns"), ActiveChunks.Num(), ActiveColumns.Num());
 }
 
-void AWorldManager::RegisterChunkAt(const FIntPoint& ChunkXY)
+AWorldChunk* AWorldManager::RegisterChunkAt(const FIntVector& ChunkCoords)
 {
-	if (!GetWorld() || !ChunkClass) return;
+	if (!GetWorld() || !ChunkClass) return nullptr;
 
 	float ChunkWorldSize = ChunkSizeXY * VoxelScale;
-	float WorldX = ChunkXY.X * ChunkWorldSize;
-	float WorldY = ChunkXY.Y * ChunkWorldSize;
+	float WorldX = ChunkCoords.X * ChunkWorldSize;
+	float WorldY = ChunkCoords.Y * ChunkWorldSize;
+	float WorldZ = ChunkCoords.Z * ChunkHeightZ * VoxelScale;
 
-	FVector SpawnLocation = FVector(WorldX, WorldY, 0.0f);
+	FVector SpawnLocation = FVector(WorldX, WorldY, WorldZ);
 
-	if (!FMath::IsFinite(WorldX) || !FMath::IsFinite(WorldY) || FMath::Abs(WorldX) > 1e6f || FMath::Abs(WorldY) > 1e6f)
+	if (!FMath::IsFinite(WorldX) || !FMath::IsFinite(WorldY) || !FMath::IsFinite(WorldZ) || FMath::Abs(WorldX) > 1e6f || FMath::Abs(WorldY) > 1e6f || FMath::Abs(WorldZ) > 1e6f)
 	{
-		UE_LOG(LogTemp, Error, TEXT("WorldManager: Invalid spawn location for chunk at {%d,%d}"), ChunkXY.X, ChunkXY.Y);
-		return;
+		UE_LOG(LogTemp, Error, TEXT("WorldManager: Invalid spawn location for chunk at {%d,%d,%d}"), ChunkCoords.X, ChunkCoords.Y, ChunkCoords.Z);
+		return nullptr;
 	}
 
-	FActorSpawnParameters SpawnParams;
-	AWorldChunk* NewChunk = GetWorld()->SpawnActor<AWorldChunk>(ChunkClass, SpawnLocation, FRotator::ZeroRotator, SpawnParams);
+	AWorldChunk* NewChunk = AcquireChunk(SpawnLocation);
 
 	if (NewChunk)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Spawning chunk at {%d,%d} world pos (%.1f, %.1f) - Active: %d"), ChunkXY.X, ChunkXY.Y, WorldX, WorldY, ActiveChunks.Num());
+		UE_LOG(LogTemp, Verbose, TEXT("Registering chunk at {%d,%d,%d} world pos (%.1f, %.1f, %.1f) - Active: %d, Pooled: %d"), ChunkCoords.X, ChunkCoords.Y, ChunkCoords.Z, WorldX, WorldY, WorldZ, ActiveChunks.Num(), ChunkPool.Num());
 
-		ActiveChunks.Add(ChunkXY, NewChunk);
+		ActiveChunks.Add(ChunkCoords, NewChunk);
 		NewChunk->SetWorldManager(this);
 		NewChunk->SetRenderMode(RenderMode);
-		NewChunk->InitializeChunk(ChunkSizeXY, ChunkHeightZ, VoxelScale, ChunkXY);
+		NewChunk->InitializeChunk(ChunkSizeXY, ChunkHeightZ, VoxelScale, ChunkCoords);
+		NewChunk->SetWantsCollision(WantsCollision(FIntPoint(ChunkCoords.X, ChunkCoords.Y)));
 	}
+
+	return NewChunk;
 }
 
-void AWorldManager::DestroyChunkAt(const FIntPoint& ChunkXY)
+void AWorldManager::DestroyChunkAt(const FIntVector& ChunkCoords)
 {
-	AWorldChunk** Found = ActiveChunks.Find(ChunkXY);
+	AWorldChunk** Found = ActiveChunks.Find(ChunkCoords);
 
 	if (!Found) return;
 
 	AWorldChunk* Chunk = *Found;
 	if (Chunk)
+	{
+		ReleaseChunk(Chunk);
+	}
+
+	if (ChunkPipeline)
+	{
+		ChunkPipeline->Cancel(ChunkCoords);
+	}
+
+	ChunkRemeshQueue.Remove(ChunkCoords);
+	EditRemeshQueue.Remove(ChunkCoords);
+	EditedChunks.Remove(ChunkCoords);
+	CollisionCookingChunks.Remove(ChunkCoords);
+	ActiveChunks.Remove(ChunkCoords);
+}
+
+AWorldChunk* AWorldManager::AcquireChunk(const FVector& Location)
+{
+	while (ChunkPool.Num() > 0)
+	{
+		AWorldChunk* Chunk = ChunkPool.Pop(EAllowShrinking::No);
+
+		// Pooled actors can still be destroyed from outside, e.g. by a level teardown
+		if (!IsValid(Chunk)) continue;
+
+		Chunk->SetActorLocation(Location);
+		return Chunk;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	return GetWorld()->SpawnActor<AWorldChunk>(ChunkClass, Location, FRotator::ZeroRotator, SpawnParams);
+}
+
+void AWorldManager::ReleaseChunk(AWorldChunk* Chunk)
+{
+	if (ChunkPool.Num() >= MaxPooledChunks)
 	{
 		Chunk->Destroy();
+		return;
 	}
 
-	ActiveChunks.Remove(ChunkXY);
+	Chunk->Deactivate();
+	ChunkPool.Add(Chunk);
+}
+
+void AWorldManager::DestroyColumnAt(const FIntPoint& ColumnXY)
+{
+	FChunkColumn Column;
+	if (!ActiveColumns.RemoveAndCopyValue(ColumnXY, Column)) return;
+
+	SaveColumnToRegion(ColumnXY, Column);
+
+	if (ChunkPipeline)
+	{
+		ChunkPipeline->Cancel(FChunkBuildJob::ColumnKey(ColumnXY));
+	}
+
+	for (int32 SectionZ = Column.MinSurfaceSection; SectionZ <= Column.MaxSurfaceSection; ++SectionZ)
+	{
+		DestroyChunkAt(FIntVector(ColumnXY.X, ColumnXY.Y, SectionZ));
+	}
+
+	// Neighbours that were waiting on this column now have one side at the edge of range instead
+	if (!Column.bGenerated)
+	{
+		for (const FIntPoint& Offset : GetMeshNeighborOffsets(RenderMode))
+		{
+			TryQueueColumnMesh(ColumnXY + Offset);
+		}
+	}
+}
+
+void AWorldManager::SaveColumnToRegion(const FIntPoint& ColumnXY, const FChunkColumn& Column)
+{
+	if (!RegionStore || !Column.bGenerated) return;
+
+	bool bModified = Column.bNeedsSave;
+
+	for (int32 SectionZ = Column.MinSurfaceSection; SectionZ <= Column.MaxSurfaceSection && !bModified; ++SectionZ)
+	{
+		const AWorldChunk* Chunk = FindChunkWithVoxels(FIntVector(ColumnXY.X, ColumnXY.Y, SectionZ));
+		bModified = Chunk && Chunk->IsModified();
+	}
+
+	// Unchanged since it was loaded, so the file already has it
+	if (!bModified) return;
+
+	FChunkColumnRecord Record;
+	Record.MinSurfaceSection = Column.MinSurfaceSection;
+	Record.MaxSurfaceSection = Column.MaxSurfaceSection;
+
+	for (int32 SectionZ = Column.MinSurfaceSection; SectionZ <= Column.MaxSurfaceSection; ++SectionZ)
+	{
+		const AWorldChunk* Chunk = FindChunkWithVoxels(FIntVector(ColumnXY.X, ColumnXY.Y, SectionZ));
+		if (!Chunk) continue;
+
+		if (Record.Columns.IsEmpty())
+		{
+			Record.Columns = Chunk->GetColumnField();
+		}
+
+		FChunkSectionVoxels& Section = Record.Sections.AddDefaulted_GetRef();
+		Section.SectionZ = SectionZ;
+		Section.Voxels = Chunk->GetVoxelData();
+	}
+
+	if (Record.Sections.Num() == 0) return;
+
+	RegionStore->SaveColumn(ColumnXY, MoveTemp(Record));
+}
+
+void AWorldManager::RunRegionLoadBenchmark(int32 Radius)
+{
+	if (!TerrainGenerator) return;
+
+	const FString Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Regions"), TEXT("Benchmark"));
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+	TArray<FIntPoint> ColumnsXY;
+	for (int32 DY = -Radius; DY <= Radius; ++DY)
+	{
+		for (int32 DX = -Radius; DX <= Radius; ++DX)
+		{
+			ColumnsXY.Add(CenterChunk + FIntPoint(DX, DY));
+		}
+	}
+
+	// Regeneration, which also produces the records the load passes read back
+	TArray<FChunkColumnRecord> Records;
+	Records.SetNum(ColumnsXY.Num());
+
+	const double GenerateStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < ColumnsXY.Num(); ++i)
+	{
+		AWorldChunk::GenerateColumnRecord(*TerrainGenerator, ColumnsXY[i], ChunkSizeXY, ChunkHeightZ, Records[i]);
+	}
+	const double GenerateSeconds = FPlatformTime::Seconds() - GenerateStart;
+
+	{
+		FRegionStore Store(Directory, ChunkSizeXY, ChunkHeightZ);
+		for (int32 i = 0; i < ColumnsXY.Num(); ++i)
+		{
+			Store.SaveColumn(ColumnsXY[i], MoveTemp(Records[i]));
+		}
+	}
+
+	// A fresh store per pass, so each one starts without region tables or mappings
+	auto TimeLoads = [&](ERegionReadMode ReadMode, int32& OutLoaded)
+	{
+		FRegionStore Store(Directory, ChunkSizeXY, ChunkHeightZ);
+		Store.SetReadMode(ReadMode);
+		OutLoaded = 0;
+
+		const double Start = FPlatformTime::Seconds();
+		for (const FIntPoint& ColumnXY : ColumnsXY)
+		{
+			FChunkColumnRecord Record;
+			OutLoaded += Store.LoadColumn(ColumnXY, Record) ? 1 : 0;
+		}
+		return FPlatformTime::Seconds() - Start;
+	};
+
+	int32 NumBuffered = 0;
+	int32 NumMapped = 0;
+	const double BufferedSeconds = TimeLoads(ERegionReadMode::Buffered, NumBuffered);
+	const double MappedSeconds = TimeLoads(ERegionReadMode::Mapped, NumMapped);
+
+	TArray<FString> RegionFiles;
+	IFileManager::Get().FindFiles(RegionFiles, *FPaths::Combine(Directory, TEXT("*.region")), true, false);
+
+	int64 FileBytes = 0;
+	for (const FString& RegionFile : RegionFiles)
+	{
+		FileBytes += IFileManager::Get().FileSize(*FPaths::Combine(Directory, RegionFile));
+	}
+
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+	// The files were just written, so both load passes read from the OS file cache
+	UE_LOG(LogTemp, Display, TEXT("Region load benchmark, %d columns (%lld KB on disk): regenerate %.1f ms, buffered %.1f ms (%d loaded), mapped %.1f ms (%d loaded)"),
+		ColumnsXY.Num(), FileBytes / 1024, GenerateSeconds * 1000.0, BufferedSeconds * 1000.0, NumBuffered, MappedSeconds * 1000.0, NumMapped);
 }
 
 bool AWorldManager::IsChunkWithinRenderDistance(const FIntPoint& ChunkXY) const
@@ -251,7 +1025,137 @@ bool AWorldManager::IsChunkWithinRenderDistance(const FIntPoint& ChunkXY) const
 	return (DX <= RenderDistance && DY <= RenderDistance);
 }
 
-void AWorldManager::OnChunkCreated(const FIntPoint& ChunkXY)
+bool AWorldManager::IsCollisionReadyAt(const FVector& WorldPos) const
+{
+	const FIntVector GV = WorldPosToGlobalVoxel(WorldPos);
+	FIntVector ChunkCoords;
+	FIntVector LocalXYZ;
+	GlobalVoxelToChunkCoords(GV.X, GV.Y, GV.Z, ChunkCoords, LocalXYZ);
+
+	const FIntPoint ColumnXY(ChunkCoords.X, ChunkCoords.Y);
+	const FChunkColumn* Column = ActiveColumns.Find(ColumnXY);
+	if (!Column || !Column->bGenerated || !WantsCollision(ColumnXY)) return false;
+
+	for (int32 SectionZ = Column->MinSurfaceSection; SectionZ <= Column->MaxSurfaceSection; ++SectionZ)
+	{
+		AWorldChunk* const* ChunkPtr = ActiveChunks.Find(FIntVector(ColumnXY.X, ColumnXY.Y, SectionZ));
+		if (ChunkPtr && *ChunkPtr && !(*ChunkPtr)->IsCollisionReady()) return false;
+	}
+
+	return true;
+}
+
+bool AWorldManager::WantsCollision(const FIntPoint& ColumnXY) const
+{
+	return FMath::Max(FMath::Abs(ColumnXY.X - CenterChunk.X), FMath::Abs(ColumnXY.Y - CenterChunk.Y)) <= CollisionDistance;
+}
+
+void AWorldManager::UpdateCollisionRange()
+{
+	// A no-op for chunks that stay on the same side of CollisionDistance
+	for (const auto& Pair : ActiveChunks)
+	{
+		AWorldChunk* Chunk = Pair.Value;
+		if (!Chunk) continue;
+
+		Chunk->SetWantsCollision(WantsCollision(FIntPoint(Pair.Key.X, Pair.Key.Y)));
+
+		if (Chunk->IsCollisionPending())
+		{
+			CollisionCookingChunks.Add(Pair.Key);
+		}
+	}
+}
+
+void AWorldManager::PollCollisionCooks()
+{
+	for (auto It = CollisionCookingChunks.CreateIterator(); It; ++It)
+	{
+		AWorldChunk** ChunkPtr = ActiveChunks.Find(*It);
+		if (!ChunkPtr || !*ChunkPtr || !(*ChunkPtr)->UpdateCollisionCook())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (bPawnHeld && PlayerPawn && IsCollisionReadyAt(PlayerPawn->GetActorLocation()))
+	{
+		SetPawnHeld(false);
+	}
+}
+
+void AWorldManager::SetPawnHeld(bool bHeld)
+{
+	UPawnMovementComponent* Movement = IsValid(PlayerPawn) ? PlayerPawn->GetMovementComponent() : nullptr;
+	if (!Movement || bHeld == bPawnHeld) return;
+
+	bPawnHeld = bHeld;
+
+	if (bHeld)
+	{
+		Movement->Deactivate();
+	}
+	else
+	{
+		Movement->Activate();
+	}
+}
+
+void AWorldManager::OnColumnGenerated(const FIntPoint& ColumnXY)
+{
+	TryQueueColumnMesh(ColumnXY);
+
+	for (const FIntPoint& Offset : GetMeshNeighborOffsets(RenderMode))
+	{
+		const FIntPoint NeighborXY = ColumnXY + Offset;
+		const FChunkColumn* Neighbor = ActiveColumns.Find(NeighborXY);
+		if (!Neighbor || !Neighbor->bGenerated) continue;
+
+		if (Neighbor->bMeshQueued)
+		{
+			// Meshed while this column was out of range, so its side or corner facing here was built against no neighbour
+			QueueColumnRemesh(NeighborXY, *Neighbor);
+		}
+		else
+		{
+			TryQueueColumnMesh(NeighborXY);
+		}
+	}
+}
+
+void AWorldManager::TryQueueColumnMesh(const FIntPoint& ColumnXY)
+{
+	FChunkColumn* Column = ActiveColumns.Find(ColumnXY);
+	if (!Column || !Column->bGenerated || Column->bMeshQueued) return;
+
+	// Columns outside range never arrive, so only the ones with a pending job hold the mesh back
+	for (const FIntPoint& Offset : GetMeshNeighborOffsets(RenderMode))
+	{
+		const FChunkColumn* Neighbor = ActiveColumns.Find(ColumnXY + Offset);
+		if (Neighbor && !Neighbor->bGenerated) return;
+	}
+
+	Column->bMeshQueued = true;
+	QueueColumnRemesh(ColumnXY, *Column);
+}
+
+int32 AWorldManager::GetLodStride(const FIntPoint& ColumnXY) const
+{
+	if (LodDistance <= 0) return 1;
+
+	const int32 Distance = FMath::Max(FMath::Abs(ColumnXY.X - CenterChunk.X), FMath::Abs(ColumnXY.Y - CenterChunk.Y));
+	if (Distance < LodDistance) return 1;
+
+	int32 Stride = 2 << FMath::Min(Distance / LodDistance - 1, 2);
+	while (Stride > 1 && (Stride > MaxLodStride || ChunkSizeXY % Stride != 0 || ChunkHeightZ % Stride != 0))
+	{
+		Stride /= 2;
+	}
+
+	return Stride;
+}
+
+void AWorldManager::UpdateLodStrides()
 {
 	static const FIntPoint Neighbors[4] = {
 		FIntPoint(1, 0),
@@ -260,13 +1164,209 @@ void AWorldManager::OnChunkCreated(const FIntPoint& ChunkXY)
 		FIntPoint(0, -1)
 	};
 
-	for (const FIntPoint& Offset : Neighbors)
+	TArray<FIntPoint> Changed;
+
+	for (auto& Pair : ActiveColumns)
+	{
+		const int32 Stride = GetLodStride(Pair.Key);
+		if (Stride == Pair.Value.LodStride) continue;
+
+		Pair.Value.LodStride = Stride;
+		Changed.Add(Pair.Key);
+	}
+
+	// Columns not meshed yet pick up their stride with their first mesh
+	for (const FIntPoint& ColumnXY : Changed)
+	{
+		const FChunkColumn& Column = ActiveColumns[ColumnXY];
+		if (Column.bMeshQueued)
+		{
+			QueueColumnRemesh(ColumnXY, Column);
+		}
+
+		for (const FIntPoint& Offset : Neighbors)
+		{
+			const FChunkColumn* Neighbor = ActiveColumns.Find(ColumnXY + Offset);
+			if (Neighbor && Neighbor->bMeshQueued)
+			{
+				QueueColumnRemesh(ColumnXY + Offset, *Neighbor);
+			}
+		}
+	}
+}
+
+void AWorldManager::QueueColumnRemesh(const FIntPoint& ColumnXY, const FChunkColumn& Column)
+{
+	for (int32 SectionZ = Column.MinSurfaceSection; SectionZ <= Column.MaxSurfaceSection; ++SectionZ)
+	{
+		const FIntVector SectionCoords(ColumnXY.X, ColumnXY.Y, SectionZ);
+		if (FindChunkWithVoxels(SectionCoords))
+		{
+			ChunkRemeshQueue.Add(SectionCoords);
+		}
+	}
+}
+
+void AWorldManager::CaptureChunkBorders(const FIntVector& ChunkCoords, FChunkMeshInput& Input) const
+{
+	// Same side order as the mesher: +X, -X, +Y, -Y, +Z, -Z
+	static const FIntVector SideOffsets[6] = {
+		FIntVector(1, 0, 0),
+		FIntVector(-1, 0, 0),
+		FIntVector(0, 1, 0),
+		FIntVector(0, -1, 0),
+		FIntVector(0, 0, 1),
+		FIntVector(0, 0, -1)
+	};
+
+	const FChunkColumn* Column = ActiveColumns.Find(FIntPoint(ChunkCoords.X, ChunkCoords.Y));
+	const int32 Stride = Column ? Column->LodStride : 1;
+	Input.LodStride = Stride;
+
+	for (int32 Side = 0; Side < 6; ++Side)
+	{
+		TArray<bool>& Border = Input.BorderSolid[Side];
+
+		const bool bVertical = Side >= 4;
+		const int32 BorderSize = ChunkSizeXY * (bVertical ? ChunkSizeXY : ChunkHeightZ);
+		const FIntVector NeighborCoords = ChunkCoords + SideOffsets[Side];
+
+		if (!bVertical)
+		{
+			const FChunkColumn* NeighborColumn = ActiveColumns.Find(FIntPoint(NeighborCoords.X, NeighborCoords.Y));
+			Input.NeighborLodStride[Side] = NeighborColumn && NeighborColumn->bGenerated ? NeighborColumn->LodStride : 0;
+		}
+
+		// Faces against chunks outside the render distance are culled
+		if (!IsChunkWithinRenderDistance(FIntPoint(NeighborCoords.X, NeighborCoords.Y)))
+		{
+			Border.Init(true, BorderSize);
+			continue;
+		}
+
+		const AWorldChunk* Neighbor = FindChunkWithVoxels(NeighborCoords);
+
+		// Sections without voxels are solid below their column's surface and open above it. Columns that are not
+		// generated yet leave their faces open too; they are remeshed once the column arrives.
+		if (!Neighbor)
+		{
+			Border.Init(IsSectionBelowSurface(NeighborCoords), BorderSize);
+			continue;
+		}
+
+		Border.SetNumUninitialized(BorderSize);
+
+		// Read the neighbour's facing slab straight from its storage
+		const FVoxelStorage& NeighborVoxels = Neighbor->GetVoxelData();
+		bool* Dest = Border.GetData();
+
+		// The low sides give the layer where a coarse mesh's padding cells start, Stride voxels out
+		if (bVertical)
+		{
+			const int32 Z = Side == 4 ? 0 : ChunkHeightZ - Stride;
+
+			for (int32 Y = 0; Y < ChunkSizeXY; ++Y)
+			{
+				for (int32 X = 0; X < ChunkSizeXY; ++X)
+				{
+					*Dest++ = NeighborVoxels.IsSolid(X, Y, Z);
+				}
+			}
+
+			continue;
+		}
+
+		const bool bAlongY = Side < 2;
+		const int32 Fixed = (Side == 0 || Side == 2) ? 0 : ChunkSizeXY - Stride;
+
+		for (int32 Z = 0; Z < ChunkHeightZ; ++Z)
+		{
+			for (int32 Along = 0; Along < ChunkSizeXY; ++Along)
+			{
+				*Dest++ = bAlongY ? NeighborVoxels.IsSolid(Fixed, Along, Z) : NeighborVoxels.IsSolid(Along, Fixed, Z);
+			}
+		}
+	}
+
+	if (Input.RenderMode != EVoxelRenderMode::MarchingCubes) return;
+
+	// The smooth mesher's padding reaches into all eight neighbours on the same level, diagonals included.
+	// Sections stored as flags are left to the mesher, which fills them from the column heights.
+	const AWorldChunk* Neighbors[3][3] = {};
+
+	for (int32 DY = -1; DY <= 1; ++DY)
+	{
+		for (int32 DX = -1; DX <= 1; ++DX)
+		{
+			if (DX == 0 && DY == 0) continue;
+
+			Neighbors[DX + 1][DY + 1] = FindChunkWithVoxels(ChunkCoords + FIntVector(DX, DY, 0));
+		}
+	}
+
+	const int32 NumColumns = FChunkMeshInput::NumBorderColumns(ChunkSizeXY);
+	Input.BorderDensity.SetNumUninitialized(NumColumns * ChunkHeightZ);
+	Input.BorderDensityValid.Init(false, NumColumns);
+
+	for (int32 Y = -1; Y <= ChunkSizeXY + 1; ++Y)
 	{
-		FIntPoint NeighborXY = ChunkXY + Offset;
-		AWorldChunk** NeighborPtr = ActiveChunks.Find(NeighborXY);
-		if (NeighborPtr && *NeighborPtr)
+		for (int32 X = -1; X <= ChunkSizeXY + 1; ++X)
 		{
-			(*NeighborPtr)->GenerateMesh();
+			const int32 Column = Input.BorderColumnIndex(X, Y);
+			if (Column == INDEX_NONE) continue;
+
+			const int32 DX = X < 0 ? -1 : (X >= ChunkSizeXY ? 1 : 0);
+			const int32 DY = Y < 0 ? -1 : (Y >= ChunkSizeXY ? 1 : 0);
+
+			// Neighbours that have no voxels yet are filled from the column heights by the mesher
+			const AWorldChunk* Neighbor = Neighbors[DX + 1][DY + 1];
+			if (!Neighbor) continue;
+
+			const FVoxelStorage& NeighborVoxels = Neighbor->GetVoxelData();
+			const int32 LX = X - DX * ChunkSizeXY;
+			const int32 LY = Y - DY * ChunkSizeXY;
+			float* Dest = &Input.BorderDensity[Column * ChunkHeightZ];
+
+			for (int32 Z = 0; Z < ChunkHeightZ; ++Z)
+			{
+				Dest[Z] = NeighborVoxels.GetDensity(LX, LY, Z);
+			}
+
+			Input.BorderDensityValid[Column] = true;
+		}
+	}
+
+	// Padding layers under and over the chunk, from the sections directly below and above
+	const int32 LayerSize = ChunkSizeXY * ChunkSizeXY;
+
+	if (const AWorldChunk* Below = FindChunkWithVoxels(ChunkCoords - FIntVector(0, 0, 1)))
+	{
+		Input.BorderDensityBelow.SetNumUninitialized(LayerSize);
+
+		for (int32 Y = 0; Y < ChunkSizeXY; ++Y)
+		{
+			for (int32 X = 0; X < ChunkSizeXY; ++X)
+			{
+				Input.BorderDensityBelow[X + Y * ChunkSizeXY] = Below->GetVoxelData().GetDensity(X, Y, ChunkHeightZ - 1);
+			}
+		}
+	}
+
+	const AWorldChunk* Above = FindChunkWithVoxels(ChunkCoords + FIntVector(0, 0, 1));
+
+	if (Above && ChunkHeightZ >= 2)
+	{
+		Input.BorderDensityAbove.SetNumUninitialized(LayerSize * 2);
+
+		for (int32 Layer = 0; Layer < 2; ++Layer)
+		{
+			for (int32 Y = 0; Y < ChunkSizeXY; ++Y)
+			{
+				for (int32 X = 0; X < ChunkSizeXY; ++X)
+				{
+					Input.BorderDensityAbove[X + Y * ChunkSizeXY + Layer * LayerSize] = Above->GetVoxelData().GetDensity(X, Y, Layer);
+				}
+			}
 		}
 	}
 }
@@ -23,7 +23,8 @@ public class ProceduralSurvival : ModuleRules
 		});
 
 		PrivateDependencyModuleNames.AddRange(new string[] {
-      "ProceduralMeshComponent"
+      "ProceduralMeshComponent",
+      "Json"
     });
 
 		PublicIncludePaths.AddRange(new string[] {
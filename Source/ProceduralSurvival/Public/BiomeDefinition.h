@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Voxel.h"
+#include "BiomeDefinition.generated.h"
+
+UENUM(BlueprintType)
+enum class EBiomeNoiseShape : uint8
+{
+	// Octaves are summed as they come
+	Smooth,
+
+	// Each octave is folded into a ridge, (1 - |n|)^2, before it is summed
+	Ridged
+};
+
+// One biome: where it appears along the biome noise and how its terrain is shaped. Add it to a terrain
+// generator's Biomes list; the generator compiles the list into an FBiomeTable the noise code batches over.
+UCLASS(BlueprintType)
+class PROCEDURALSURVIVAL_API UBiomeDefinition : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// Color of the biome on the far-field horizon
+	UPROPERTY(EditAnywhere, Category = "Biome")
+	FColor Color = FColor::Green;
+
+	// Start of the biome's band along the biome noise, remapped to 0..1. 0 or less leaves the band open below.
+	UPROPERTY(EditAnywhere, Category = "Biome | Placement")
+	float LowerEdge = 0.0f;
+
+	// End of the band. 1 or more leaves the band open above.
+	UPROPERTY(EditAnywhere, Category = "Biome | Placement")
+	float UpperEdge = 1.0f;
+
+	// Half the width of the blend at each edge
+	UPROPERTY(EditAnywhere, Category = "Biome | Placement", meta = (ClampMin = "0.001"))
+	float BlendWidth = 0.1f;
+
+	// Multiplies the band weight before weights are normalized, favouring the biome where bands overlap
+	UPROPERTY(EditAnywhere, Category = "Biome | Placement", meta = (ClampMin = "0"))
+	float WeightScale = 1.0f;
+
+	// Ignore the band and take whatever weight the banded biomes leave over
+	UPROPERTY(EditAnywhere, Category = "Biome | Placement")
+	bool bFillsRemainder = false;
+
+	UPROPERTY(EditAnywhere, Category = "Biome | Terrain")
+	float Frequency = 0.006f;
+
+	UPROPERTY(EditAnywhere, Category = "Biome | Terrain")
+	float Amplitude = 15.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Biome | Terrain")
+	float BaseHeight = 10.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Biome | Terrain")
+	EBiomeNoiseShape Shape = EBiomeNoiseShape::Smooth;
+
+	// Weight of each octave; every octave doubles the frequency of the one before. At most 8 are used.
+	UPROPERTY(EditAnywhere, Category = "Biome | Terrain")
+	TArray<float> OctaveWeights = { 0.7f, 0.2f };
+
+	// The top voxel of each column
+	UPROPERTY(EditAnywhere, Category = "Biome | Materials")
+	EVoxelMaterial SurfaceMaterial = EVoxelMaterial::Grass;
+
+	// The voxels under the top one, down to SubsurfaceDepth
+	UPROPERTY(EditAnywhere, Category = "Biome | Materials")
+	EVoxelMaterial SubsurfaceMaterial = EVoxelMaterial::Dirt;
+
+	UPROPERTY(EditAnywhere, Category = "Biome | Materials", meta = (ClampMin = "1"))
+	float SubsurfaceDepth = 4.0f;
+
+	// Everything deeper, and the surface of columns steeper than MaxSurfaceSlope
+	UPROPERTY(EditAnywhere, Category = "Biome | Materials")
+	EVoxelMaterial DeepMaterial = EVoxelMaterial::Stone;
+
+	// Height change per voxel across a column above which its surface is bare DeepMaterial
+	UPROPERTY(EditAnywhere, Category = "Biome | Materials", meta = (ClampMin = "0"))
+	float MaxSurfaceSlope = 1.5f;
+
+	// Columns at least this high are topped with snow instead. 0 or less never snows.
+	UPROPERTY(EditAnywhere, Category = "Biome | Materials")
+	float SnowHeight = 0.0f;
+};
+
+// Weight of every biome in a table at one column, indexed like the table
+struct PROCEDURALSURVIVAL_API FBiomeWeights
+{
+	static constexpr int32 MaxBiomes = 16;
+
+	float Weights[MaxBiomes];
+	int32 Num = 0;
+
+	// Weights between four grid nodes, lerped in a fixed order so every caller gets the same bits.
+	// An alpha of 0 returns the node's weights exactly.
+	static FBiomeWeights Bilinear(const FBiomeWeights& W00, const FBiomeWeights& W10, const FBiomeWeights& W01, const FBiomeWeights& W11, float AlphaX, float AlphaY);
+};
+
+// Biome definitions flattened into plain values, safe to read from worker threads. Columns store a biome as
+// its index in the table, so reordering the list changes what saved regions mean.
+struct PROCEDURALSURVIVAL_API FBiomeTable
+{
+	static constexpr int32 MaxOctaves = 8;
+
+	struct FEntry
+	{
+		FColor Color = FColor::Green;
+
+		float LowerEdge = 0.0f;
+		float UpperEdge = 1.0f;
+		float BlendWidth = 0.1f;
+		float WeightScale = 1.0f;
+		bool bFillsRemainder = false;
+
+		float Frequency = 0.0f;
+		float Amplitude = 0.0f;
+		float BaseHeight = 0.0f;
+		bool bRidged = false;
+		int32 NumOctaves = 0;
+		float OctaveWeights[MaxOctaves] = {};
+
+		EVoxelMaterial SurfaceMaterial = EVoxelMaterial::Grass;
+		EVoxelMaterial SubsurfaceMaterial = EVoxelMaterial::Dirt;
+		EVoxelMaterial DeepMaterial = EVoxelMaterial::Stone;
+		float SubsurfaceDepth = 4.0f;
+		float MaxSurfaceSlope = 1.5f;
+		float SnowHeight = 0.0f;
+	};
+
+	TArray<FEntry> Entries;
+
+	int32 Num() const { return Entries.Num(); }
+
+	FColor GetColor(uint8 Biome) const { return Entries.IsValidIndex(Biome) ? Entries[Biome].Color : FColor::Magenta; }
+
+	// Flattens the non-null definitions, up to FBiomeWeights::MaxBiomes. An empty list gives the default table.
+	void Compile(const TArray<UBiomeDefinition*>& Definitions);
+
+	// Weight of every biome for a biome noise value in -1..1, normalized to sum to 1
+	FBiomeWeights WeightsFromNoise(float BiomeNoise) const;
+
+	// A biome's height from its octave noise values, lowest frequency first
+	float HeightFromOctaves(int32 Biome, const float* Octaves) const;
+
+	// Material of a solid voxel Depth below the surface of a column with the given height and slope
+	EVoxelMaterial GetMaterial(uint8 Biome, float Height, float Slope, float Depth) const;
+
+	// Plains, hills and mountains, the terrain the project shipped with
+	static const FBiomeTable& GetDefault();
+};
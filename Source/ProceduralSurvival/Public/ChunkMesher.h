@@ -0,0 +1,201 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelStorage.h"
+#include "VoxelRenderMode.h"
+#include "TerrainGenerator.h"
+
+// The triangles of a chunk mesh made of one voxel material, ready for CreateMeshSection
+struct FChunkMeshSection
+{
+	uint8 Material = 0;
+
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+
+	// Only filled for materials drawn with the debug material
+	TArray<FColor> VertexColors;
+};
+
+// Vertex streams for one mesh, built on a worker and handed to CreateMeshSection on the game thread.
+// Far-field tiles upload the streams as one section. Chunk meshers tag every triangle with its voxel material
+// while they build, then split the streams into Sections, leaving them empty.
+struct FChunkMeshData
+{
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FColor> VertexColors;
+
+	// One per triangle in Triangles
+	TArray<uint8> TriangleMaterials;
+
+	// One per material the chunk mesh uses, ordered by material
+	TArray<FChunkMeshSection> Sections;
+
+	void Reset();
+
+	int32 GetNumTriangles() const;
+	int32 GetNumVertices() const;
+	SIZE_T GetAllocatedSize() const;
+};
+
+// Densities on the lattice a smooth mesh reads: the chunk's own voxels plus one point of padding on every
+// side, and a second one on the high sides because the last cells reach ChunkSizeXY and ChunkHeightZ.
+// Local coordinates run from -1 to ChunkSizeXY + 1 on X/Y and -1 to ChunkHeightZ + 1 on Z.
+struct FChunkDensityGrid
+{
+	int32 SizeXY = 0;
+	int32 SizeZ = 0;
+	TArray<float> Values;
+
+	void Init(int32 ChunkSizeXY, int32 ChunkHeightZ);
+
+	int32 Index(int32 X, int32 Y, int32 Z) const { return (X + 1) + (Y + 1) * SizeXY + (Z + 1) * SizeXY * SizeXY; }
+
+	float Get(int32 X, int32 Y, int32 Z) const { return Values[Index(X, Y, Z)]; }
+
+	// Central difference at a lattice point; valid from 0 to ChunkSizeXY / ChunkHeightZ on each axis
+	FVector Gradient(int32 X, int32 Y, int32 Z) const
+	{
+		return FVector(
+			Get(X + 1, Y, Z) - Get(X - 1, Y, Z),
+			Get(X, Y + 1, Z) - Get(X, Y - 1, Z),
+			Get(X, Y, Z + 1) - Get(X, Y, Z - 1)) * 0.5f;
+	}
+};
+
+// Solidity of the chunk's voxels plus one voxel of padding on every side, so face culling is a plain array
+// read. Padding comes from the neighbour borders; without them, below the chunk counts as solid (bottom faces
+// of the lowest layer are never drawn) and above it as empty.
+struct FChunkSolidMask
+{
+	int32 SizeXY = 0;
+	int32 SizeZ = 0;
+	TArray<bool> Values;
+
+	void Init(int32 ChunkSizeXY, int32 ChunkHeightZ);
+
+	int32 Index(int32 X, int32 Y, int32 Z) const { return (X + 1) + (Y + 1) * SizeXY + (Z + 1) * SizeXY * SizeXY; }
+
+	bool IsSolid(int32 X, int32 Y, int32 Z) const { return Values[Index(X, Y, Z)]; }
+};
+
+// Everything the meshers need, captured up front so a build never touches the chunk actor or the world
+struct FChunkMeshInput
+{
+	// Chunk X/Y and vertical section Z. The section covers global Z from ChunkCoords.Z * ChunkHeightZ up.
+	FIntVector ChunkCoords = FIntVector::ZeroValue;
+	int32 ChunkSizeXY = 32;
+	int32 ChunkHeightZ = 32;
+	float VoxelScale = 100.0f;
+	EVoxelRenderMode RenderMode = EVoxelRenderMode::Cubes;
+
+	// Voxels per mesh cell along each axis: 1 at full detail, 2, 4 or 8 for distant chunks. The voxels stay at
+	// full resolution; only the mesh is coarser. Must divide ChunkSizeXY and ChunkHeightZ, or 1 is used.
+	int32 LodStride = 1;
+
+	// LodStride of the neighbouring chunk on each horizontal side, ordered like BorderSolid, or 0 if unknown.
+	// Where it differs from LodStride the two meshes do not meet exactly and the side gets a skirt.
+	int32 NeighborLodStride[4] = { 0, 0, 0, 0 };
+
+	const UTerrainGenerator* TerrainGenerator = nullptr;
+
+	// Bit per voxel material that the chunk draws with its debug material, which shows vertex colors.
+	// Sections of those materials get the material's debug color; the others carry no colors.
+	uint32 DebugColorMaterials = 0;
+
+	// Column heights and biomes covering the chunk plus the density grid's padding. When present,
+	// density and biome lookups come from here instead of re-running the noise stack.
+	FTerrainColumnField Columns;
+
+	// Solidity of the voxel layer just outside each side of the chunk, ordered +X, -X, +Y, -Y, +Z, -Z.
+	// Indexed by Along + Z * ChunkSizeXY on the horizontal sides and X + Y * ChunkSizeXY on the vertical ones.
+	// On the low sides of a coarse chunk it is the layer LodStride voxels out, where its padding cells start.
+	// Empty when the chunk has no world manager.
+	TArray<bool> BorderSolid[6];
+
+	// Densities the neighbouring chunks hold for the padding columns around this one, so edits on the far
+	// side of a seam reach the smooth mesh. ChunkHeightZ values per column, ordered by BorderColumnIndex.
+	// Only captured for smooth meshes.
+	TArray<float> BorderDensity;
+
+	// Per padding column, false where the neighbour had no voxels and the mesher uses Columns instead
+	TArray<bool> BorderDensityValid;
+
+	// Densities the sections below and above hold for the padding layers: Z = -1 below, and Z = ChunkHeightZ
+	// and ChunkHeightZ + 1 above. Indexed by X + Y * ChunkSizeXY, plus Layer * ChunkSizeXY^2 above. Empty when
+	// that section has no voxels, in which case the layers follow Columns.
+	TArray<float> BorderDensityBelow;
+	TArray<float> BorderDensityAbove;
+
+	static int32 NumBorderColumns(int32 InChunkSizeXY) { return 6 * InChunkSizeXY + 9; }
+
+	bool HasLodSeam(int32 Side) const { return NeighborLodStride[Side] > 0 && NeighborLodStride[Side] != LodStride; }
+
+	// Index of a padding column in BorderDensity, or INDEX_NONE for columns inside the chunk
+	int32 BorderColumnIndex(int32 X, int32 Y) const;
+};
+
+// Builds chunk meshes from voxel data. Safe to run off the game thread.
+class PROCEDURALSURVIVAL_API FChunkMesher
+{
+public:
+	FChunkMesher(const FChunkMeshInput& InInput, const FVoxelStorage& InVoxels);
+
+	void Build(FChunkMeshData& Out) const;
+
+	// Flat color standing in for a voxel material without a proper one
+	static FColor GetMaterialDebugColor(uint8 Material);
+
+private:
+	const FChunkMeshInput& Input;
+	const FVoxelStorage& Voxels;
+
+	// Input.LodStride once validated, and the mesh cells it gives per chunk
+	int32 Stride = 1;
+	int32 CellsXY = 0;
+	int32 CellsZ = 0;
+
+	// Copies voxel solidity and the captured borders into one padded array, one entry per mesh cell. A coarse
+	// cell takes the voxel at its first corner, like the smooth lattice. Sides with an LOD seam are left open so
+	// the border faces close any gap to the neighbour.
+	void BuildSolidMask(FChunkSolidMask& Mask) const;
+
+	void BuildCubic(FChunkMeshData& Out) const;
+
+	// Same faces as BuildCubic, with coplanar faces of matching material merged into rectangles per slice
+	void BuildGreedyCubes(FChunkMeshData& Out) const;
+
+	// Non-zero when the face is visible, equal for faces that may merge
+	uint32 GetGreedyFaceKey(int FaceIndex, int X, int Y, int Z, const FChunkSolidMask& Solid) const;
+
+	void AddGreedyQuad(int FaceIndex, int Slice, int U, int V, int Width, int Height, uint8 Material, FChunkMeshData& Out) const;
+	void BuildMarchingCubes(FChunkMeshData& Out) const;
+
+	void AddCubeFace(int FaceIndex, const FVector& Position, uint8 Material, FChunkMeshData& Out) const;
+
+	// Material of a smooth cell's triangles: the voxel at its highest solid corner, which is the surface
+	// material wherever the surface is. Corners past the chunk's edge read the nearest voxel inside.
+	uint8 GetCellMaterial(int X, int Y, int Z, const float* CornerDensities, float IsoLevel) const;
+
+	// Regroups the streams into one section per material. Vertices shared across materials are duplicated.
+	void SplitByMaterial(FChunkMeshData& Out) const;
+
+	// Reads every lattice point once, from the voxels, the captured borders or the column heights. Coarse
+	// lattices sample every Stride-th voxel, so chunks of equal stride share their seam points; their outer
+	// padding is derived from the voxels either side of the chunk's edge, so no lattice point needs the noise.
+	void BuildDensityGrid(FChunkDensityGrid& Grid) const;
+
+	// Hangs a strip below every mesh edge lying on a side with an LOD seam, covering the crack to the
+	// neighbour's differently sampled surface. Double sided, since the crack can be seen from either side.
+	void AddSkirts(FChunkMeshData& Out) const;
+
+	float GetColumnHeight(int GlobalX, int GlobalY) const;
+
+	// Where the surface crosses an edge, as a fraction of the way from P1 to P2
+	float EdgeAlpha(float IsoLevel, float ValP1, float ValP2) const;
+};
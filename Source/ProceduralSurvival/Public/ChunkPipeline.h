@@ -0,0 +1,118 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Tasks/Task.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include "ChunkMesher.h"
+#include "VoxelStorage.h"
+#include "RegionStore.h"
+#include "FarFieldTerrain.h"
+#include <atomic>
+
+class AWorldChunk;
+
+enum class EChunkJobType : uint8
+{
+	// Column field for one chunk column, plus voxels for every section the surface passes through.
+	// Loaded from the region store when the column was saved before, generated otherwise.
+	GenerateColumn,
+
+	// Mesh for one section from a copy of its voxels
+	Mesh,
+
+	// Heightfield mesh for one far-field tile, straight from the terrain generator
+	FarFieldTile
+};
+
+// One unit of chunk work, run on a worker thread
+struct FChunkBuildJob
+{
+	EChunkJobType Type = EChunkJobType::Mesh;
+
+	// Section coords for mesh jobs, ColumnKey for column jobs
+	FIntVector ChunkCoords = FIntVector::ZeroValue;
+
+	// The actor a mesh belongs to. Checked again on the game thread before anything is applied.
+	TWeakObjectPtr<AWorldChunk> Chunk;
+
+	// Chunk voxel revision the copy was taken at, used to drop stale remesh results
+	int32 VoxelRevision = 0;
+
+	// Column jobs read the sizes and generator from here and leave the column field in Columns
+	FChunkMeshInput MeshInput;
+	FVoxelStorage Voxels;
+	FChunkMeshData MeshData;
+
+	// Column job results: the sections the surface passes through and their voxels, lowest first
+	int32 MinSurfaceSection = 0;
+	int32 MaxSurfaceSection = -1;
+	TArray<FChunkSectionVoxels> Sections;
+
+	// Where column jobs look for saved columns first. Null when persistence is off.
+	FRegionStore* RegionStore = nullptr;
+
+	// Set when the column came from the region store rather than the noise
+	bool bLoadedFromDisk = false;
+
+	// What a far-field job builds. It reads the generator from MeshInput and leaves the mesh in MeshData.
+	FFarFieldTile FarFieldTile;
+
+	// Pipeline key of a column job. Sections never reach this Z, so it can share the map with mesh jobs.
+	static FIntVector ColumnKey(const FIntPoint& ColumnXY) { return FIntVector(ColumnXY.X, ColumnXY.Y, MIN_int32); }
+
+	// Pipeline key of a far-field job, kept apart from sections and columns the same way
+	static FIntVector FarFieldKey(const FIntPoint& TileXY) { return FIntVector(TileXY.X, TileXY.Y, MIN_int32 + 1); }
+
+	std::atomic<bool> bCancelled { false };
+
+	bool IsCancelled() const { return bCancelled.load(std::memory_order_relaxed); }
+};
+
+// Runs chunk build jobs on the task graph worker pool. Dispatch, cancellation and
+// collecting results all happen on the game thread; only the job bodies run on workers.
+class PROCEDURALSURVIVAL_API FChunkPipeline
+{
+public:
+	~FChunkPipeline();
+
+	void SetMaxInFlight(int32 InMaxInFlight) { MaxInFlight = FMath::Max(1, InMaxInFlight); }
+
+	// Cancelled jobs count until their worker has finished and they are popped, so the cap holds while moving
+	int32 GetNumInFlight() const { return InFlight.Num() + NumCancelled; }
+	int32 GetNumFreeSlots() const { return FMath::Max(0, MaxInFlight - GetNumInFlight()); }
+	bool IsInFlight(const FIntVector& ChunkCoords) const { return InFlight.Contains(ChunkCoords); }
+
+	void Dispatch(const TSharedRef<FChunkBuildJob>& Job);
+
+	// Marks the job with this key as cancelled. The worker stops at its next stage boundary (after the load or noise,
+	// after each section's voxels, before meshing) and the result is dropped.
+	void Cancel(const FIntVector& ChunkCoords);
+
+	// Cancels everything and blocks until all workers have finished
+	void Shutdown();
+
+	// Pops the next finished job that was not cancelled
+	bool PopCompleted(TSharedPtr<FChunkBuildJob>& OutJob);
+
+	// The job PopCompleted would return next, left in the queue so the caller can decide whether it has time to
+	// apply it. Null when nothing has finished. Finished jobs keep their slot until they are popped.
+	const FChunkBuildJob* PeekCompleted();
+
+private:
+	int32 MaxInFlight = 8;
+
+	TMap<FIntVector, TSharedPtr<FChunkBuildJob>> InFlight;
+
+	// Cancelled jobs whose worker may still be running
+	int32 NumCancelled = 0;
+
+	TArray<UE::Tasks::FTask> Tasks;
+
+	TQueue<TSharedPtr<FChunkBuildJob>, EQueueMode::Mpsc> Completed;
+
+	// Clears the in-flight entry of a job taken off the Completed queue
+	void Retire(const TSharedPtr<FChunkBuildJob>& Job);
+
+	static void RunJob(FChunkBuildJob& Job);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ChunkMesher.h"
+#include "FarFieldTerrain.generated.h"
+
+class UProceduralMeshComponent;
+class UTerrainGenerator;
+
+// One far-field tile as it should be built: a square of columns sampled every Step voxels, minus the chunks the
+// voxel terrain covers. Everything a worker needs, so tiles build without touching the actor.
+struct FFarFieldTile
+{
+	FIntPoint TileXY = FIntPoint::ZeroValue;
+
+	// First column of the tile and its width, in voxels
+	FIntPoint Origin = FIntPoint::ZeroValue;
+	int32 SizeVoxels = 0;
+
+	int32 Step = 8;
+
+	// Chunks inside the tile that the voxel terrain draws, inclusive. Empty while HoleMin.X > HoleMax.X.
+	FIntPoint HoleMin = FIntPoint(1, 1);
+	FIntPoint HoleMax = FIntPoint(0, 0);
+
+	int32 ChunkSizeXY = 32;
+	float VoxelScale = 100.0f;
+
+	bool HasHole() const { return HoleMin.X <= HoleMax.X && HoleMin.Y <= HoleMax.Y; }
+
+	// Same step and hole, so a mesh built for one fits the other
+	bool IsSameBuild(const FFarFieldTile& Other) const
+	{
+		return Step == Other.Step && HoleMin == Other.HoleMin && HoleMax == Other.HoleMax;
+	}
+};
+
+// Heightfield horizon beyond the voxel terrain, in square tiles of FarFieldTileChunks chunks out to an outer
+// radius. Tiles read only UTerrainGenerator heights and biomes, sampled more coarsely the farther out they are,
+// and have no collision. The world manager builds them on its chunk pipeline once streaming is idle; this actor
+// decides which tiles are needed for a center and owns their mesh sections.
+UCLASS()
+class PROCEDURALSURVIVAL_API AFarFieldTerrain : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFarFieldTerrain();
+
+	// InnerRadius is the voxel render distance in chunks, OuterRadius how far the horizon reaches
+	void Configure(int32 InChunkSizeXY, float InVoxelScale, int32 InInnerRadius, int32 InOuterRadius);
+
+	// Drops tiles that left the outer radius and queues every tile that is new or whose step or hole changed
+	void SetCenter(const FIntPoint& InCenterChunk);
+
+	// Takes the queued tile closest to the center. False when nothing is queued.
+	bool PopPendingTile(FFarFieldTile& OutTile);
+
+	bool HasPendingTiles() const { return PendingTiles.Num() > 0; }
+
+	// Uploads a built tile, unless the tile was dropped or changed while it was building
+	void ApplyTileMesh(const FFarFieldTile& Tile, const FChunkMeshData& MeshData);
+
+	// Heightfield mesh for a tile, positioned in world space. Only reads the generator, so it is safe on workers.
+	static void BuildTileMesh(const UTerrainGenerator& TerrainGen, const FFarFieldTile& Tile, FChunkMeshData& Out);
+
+	// Tile width in chunks
+	UPROPERTY(EditAnywhere, Category = "Far Field", meta = (ClampMin = "1"))
+	int32 TileChunks = 4;
+
+	// Voxels between samples in the nearest tiles. Doubles every StepRingTiles tiles further out, up to MaxStep.
+	UPROPERTY(EditAnywhere, Category = "Far Field", meta = (ClampMin = "1"))
+	int32 BaseStep = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Far Field", meta = (ClampMin = "1"))
+	int32 StepRingTiles = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Far Field", meta = (ClampMin = "1"))
+	int32 MaxStep = 32;
+
+	UPROPERTY(EditAnywhere, Category = "Far Field")
+	UMaterialInterface* Material = nullptr;
+
+private:
+	UPROPERTY(VisibleAnywhere)
+	UProceduralMeshComponent* Mesh;
+
+	int32 ChunkSizeXY = 32;
+	float VoxelScale = 100.0f;
+	int32 InnerRadius = 4;
+	int32 OuterRadius = 64;
+
+	FIntPoint CenterChunk = FIntPoint::ZeroValue;
+
+	// Tiles wanted for the current center, by tile coordinates
+	TMap<FIntPoint, FFarFieldTile> Tiles;
+
+	// Mesh section of every tile that has been uploaded, and section indices free for reuse
+	TMap<FIntPoint, int32> TileSections;
+	TArray<int32> FreeSections;
+
+	TSet<FIntPoint> PendingTiles;
+
+	// The tile as it should be built for the current center. False when the voxel terrain covers all of it.
+	bool MakeTile(const FIntPoint& TileXY, FFarFieldTile& OutTile) const;
+
+	void RemoveTileSection(const FIntPoint& TileXY);
+};
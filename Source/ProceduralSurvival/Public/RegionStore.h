@@ -0,0 +1,120 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Async/MappedFileHandle.h"
+#include "Tasks/Pipe.h"
+#include "TerrainGenerator.h"
+#include "VoxelStorage.h"
+
+// Voxels for one vertical section of a chunk column
+struct FChunkSectionVoxels
+{
+	int32 SectionZ = 0;
+	FVoxelStorage Voxels;
+};
+
+// Everything needed to bring a chunk column back without running the noise: its surface range, the padded
+// column field and the voxels of every section it stores
+struct FChunkColumnRecord
+{
+	int32 MinSurfaceSection = 0;
+	int32 MaxSurfaceSection = -1;
+	FTerrainColumnField Columns;
+	TArray<FChunkSectionVoxels> Sections;
+};
+
+enum class ERegionReadMode : uint8
+{
+	// Records are decompressed straight out of a read-only mapping of the region file
+	Mapped,
+
+	// Records are read into a buffer first. Also the fallback where mapping is not available.
+	Buffered
+};
+
+// Chunk columns saved to region files of RegionSize x RegionSize columns under Directory.
+//
+// A region file starts with a header and an offset table with one entry per column, followed by the column
+// records, each LZ4 compressed on its own. Records are only ever appended; saving a column again writes a new
+// record and repoints its table entry, so a crash mid-write leaves the previous record reachable.
+//
+// Loads run on the chunk pipeline's workers. Saves are queued and written in order on a background pipe;
+// a load for a column with a queued save returns the queued record. A region's mapping is dropped before
+// anything is written to its file and made again by the next load, so it always covers the whole table.
+class PROCEDURALSURVIVAL_API FRegionStore
+{
+public:
+	static constexpr int32 RegionSize = 16;
+
+	// Files written with a different chunk size are ignored, and replaced on the next save to that region
+	FRegionStore(const FString& InDirectory, int32 InChunkSizeXY, int32 InChunkHeightZ);
+	~FRegionStore();
+
+	// False when the column was never saved or its record cannot be read. Safe on any thread.
+	bool LoadColumn(const FIntPoint& ColumnXY, FChunkColumnRecord& OutRecord);
+
+	void SaveColumn(const FIntPoint& ColumnXY, FChunkColumnRecord&& Record);
+
+	// Blocks until every queued save is on disk
+	void Flush();
+
+	void SetReadMode(ERegionReadMode InReadMode) { ReadMode = InReadMode; }
+
+private:
+	struct FRegionEntry
+	{
+		int64 Offset = 0;
+		int32 CompressedSize = 0;
+		int32 UncompressedSize = 0;
+	};
+
+	// The offset table of one region file, read on first use
+	struct FRegion
+	{
+		bool bFileValid = false;
+		TArray<FRegionEntry> Entries;
+
+		// Declared in this order so the view is unmapped before its file handle closes
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		TUniquePtr<IMappedFileRegion> MappedView;
+	};
+
+	FString Directory;
+	int32 ChunkSizeXY = 0;
+	int32 ChunkHeightZ = 0;
+
+	ERegionReadMode ReadMode = ERegionReadMode::Mapped;
+
+	// Guards Regions, Pending and the files themselves
+	FCriticalSection Lock;
+
+	// Held shared while a load decompresses out of a mapping and exclusively while a write drops one.
+	// Taken before Lock.
+	FRWLock MappingLock;
+
+	TMap<FIntPoint, TUniquePtr<FRegion>> Regions;
+
+	// Saved records that are not on disk yet
+	TMap<FIntPoint, TSharedPtr<FChunkColumnRecord>> Pending;
+
+	UE::Tasks::FPipe WritePipe { UE_SOURCE_LOCATION };
+
+	static FIntPoint GetRegionCoords(const FIntPoint& ColumnXY);
+	static int32 GetEntryIndex(const FIntPoint& ColumnXY);
+
+	FString GetRegionPath(const FIntPoint& RegionXY) const;
+
+	// Lock must be held
+	FRegion& FindOrReadRegion(const FIntPoint& RegionXY);
+
+	// The entry's bytes inside the region's mapping, mapping the file first if needed. Null when the file
+	// cannot be mapped. Lock and MappingLock (shared) must be held, and the pointer only lives as long as the latter.
+	const uint8* MapEntry(const FIntPoint& RegionXY, FRegion& Region, const FRegionEntry& Entry);
+
+	// Runs on the write pipe
+	void WriteColumn(const FIntPoint& ColumnXY, const TSharedPtr<FChunkColumnRecord>& Record);
+
+	static void SerializeEntry(FArchive& Ar, FRegionEntry& Entry);
+	static void SerializeRecord(FArchive& Ar, FChunkColumnRecord& Record);
+};
@@ -4,24 +4,66 @@
 
 #include "CoreMinimal.h"
 #include "UObject/Object.h"
+#include "TerrainNoise.h"
+#include "BiomeDefinition.h"
 #include "TerrainGenerator.generated.h"
 
-UENUM(BlueprintType)
-enum class EBiomeType : uint8
+// Biome weights sampled every Step columns on a grid aligned to the world origin: node (I, J) sits at global column
+// (I * Step, J * Step), and columns in between are bilinear. Covers Size nodes starting at node Origin.
+struct FBiomeWeightGrid
 {
-	Plains UMETA(DisplayName = "Plains"),
-	Hills UMETA(DisplayName = "Hills"),
-	Mountains UMETA(DisplayName = "Mountain")
+	int32 Step = 1;
+	FIntPoint Origin = FIntPoint::ZeroValue;
+	FIntPoint Size = FIntPoint::ZeroValue;
+	TArray<FBiomeWeights> Weights;
+
+	bool IsEmpty() const { return Weights.Num() == 0; }
+
+	// The node at or below Coord on one axis, and how far Coord is towards the next node. The next node is
+	// only read when the alpha is non-zero.
+	static void Locate(float Coord, int32 InStep, int32& OutNode, float& OutAlpha)
+	{
+		OutNode = FMath::FloorToInt(Coord / InStep);
+		OutAlpha = (Coord - (float)(OutNode * InStep)) / InStep;
+	}
+
+	// Interpolated weights at a column, which must lie inside the grid
+	FBiomeWeights Sample(float X, float Y) const;
 };
 
-USTRUCT()
-struct FBiomeWeights
+// Terrain height and dominant biome for a rectangle of columns, evaluated once per (X,Y) column.
+// Coordinates are global voxel coordinates; the rectangle starts at Origin and is Size columns wide.
+struct FTerrainColumnField
 {
-	GENERATED_BODY()
+	FIntPoint Origin = FIntPoint::ZeroValue;
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	TArray<float> Heights;
+
+	// Dominant biome of each column, as an index into the generator's biome table
+	TArray<uint8> Biomes;
+
+	// The coarse weights the heights and biomes were built from, for anything that needs more than the dominant
+	// biome. Not saved with region records; columns loaded from disk rebuild it, which costs a few dozen samples.
+	FBiomeWeightGrid BiomeWeights;
+
+	bool IsEmpty() const { return Heights.Num() == 0; }
+
+	bool Contains(int32 X, int32 Y) const
+	{
+		return X >= Origin.X && X < Origin.X + Size.X && Y >= Origin.Y && Y < Origin.Y + Size.Y;
+	}
+
+	int32 Index(int32 X, int32 Y) const { return (X - Origin.X) + (Y - Origin.Y) * Size.X; }
+
+	float GetHeight(int32 X, int32 Y) const { return Heights[Index(X, Y)]; }
+	uint8 GetBiome(int32 X, int32 Y) const { return Biomes[Index(X, Y)]; }
 
-	float Plains = 0.0f;
-	float Hills = 0.0f;
-	float Mountains = 0.0f;
+	// Same value UTerrainGenerator::GetBiomeWeights returns for this column, without touching the noise
+	FBiomeWeights GetBiomeWeights(int32 X, int32 Y) const { return BiomeWeights.Sample((float)X, (float)Y); }
+
+	// Same value UTerrainGenerator::GetDensity returns for this column
+	float GetDensity(int32 X, int32 Y, float Z) const { return GetHeight(X, Y) - Z; }
 };
 
 UCLASS(Blueprintable, BlueprintType)
@@ -31,6 +73,11 @@ class PROCEDURALSURVIVAL_API UTerrainGenerator : public UObject
 	
 public:	
 
+	// World seed. 0 is the original terrain; every other value is a different world, identical wherever it is
+	// generated. Set it through SetSeed at runtime so the noise tables follow.
+	UPROPERTY(EditAnywhere, Category = "Terrain")
+	int32 Seed = 0;
+
 	UPROPERTY(EditAnywhere, Category = "Terrain | Surface Noise")
 	float SurfaceNoiseAmplitude = 2.0f;
 	
@@ -47,26 +94,15 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Terrain | Biomes")
 	float BiomeScale = 2000.0f;
 
-	UPROPERTY(EditAnywhere, Category = "Terrain | Plains")
-	float PlainsFrequency = 0.006f;
-
-	UPROPERTY(EditAnywhere, Category = "Terrain | Plains")
-	float PlainsAmplitude = 15.0f;
-
-	UPROPERTY(EditAnywhere, Category = "Terrain | Plains")
-	float PlainsBaseHeight = 10.0f;
+	// Columns between biome weight samples. Weights in between are interpolated, which at BiomeScale barely
+	// moves a biome edge but saves the two biome lookups per column. 1 samples every column.
+	UPROPERTY(EditAnywhere, Category = "Terrain | Biomes", meta = (ClampMin = "1"))
+	int32 BiomeGridStep = 8;
 
-	UPROPERTY(EditAnywhere, Category = "Terrain | Hills")
-	float HillsFrequency = 0.008f;
-
-	UPROPERTY(EditAnywhere, Category = "Terrain | Hills")
-	float HillsAmplitude = 25.0f;
-
-	UPROPERTY(EditAnywhere, Category = "Terrain | Mountains")
-	float MountainsFrequency = 0.005f;
-
-	UPROPERTY(EditAnywhere, Category = "Terrain | Mountains")
-	float MountainsAmplitude = 45.0f;
+	// Biomes in the order their bands are weighed. Empty uses the built-in plains, hills and mountains.
+	// Recompiled when the generator loads or is edited; call SetBiomes to change them at runtime.
+	UPROPERTY(EditAnywhere, Category = "Terrain | Biomes")
+	TArray<UBiomeDefinition*> Biomes;
 
 	UPROPERTY(EditAnywhere, Category = "Terrain | Rivers")
 	bool EnableRivers = false;
@@ -80,18 +116,67 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Terrain | Rivers")
 	float RiverDepth = 15.0f;
 
+	// Rebuilds the noise tables for a new seed. Game thread only, while no chunk jobs are running.
+	void SetSeed(int32 InSeed);
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	float GetTerrainHeight(float X, float Y) const;
 	float GetDensity(float X, float Y, float Z) const;
 	FBiomeWeights GetBiomeWeights(float X, float Y) const;
-	EBiomeType GetDominantBiome(float X, float Y) const;
+	uint8 GetDominantBiome(float X, float Y) const;
+
+	// Replaces the biome list. Game thread only, while no chunk jobs are running.
+	void SetBiomes(const TArray<UBiomeDefinition*>& InBiomes);
+
+	const FBiomeTable& GetBiomeTable() const { return BiomeTable; }
+
+	// Batched height and biome lookup for SizeX * SizeY columns starting at (OriginX, OriginY).
+	// Each noise term is evaluated as one grid through FTerrainNoise, and biome terrains no column
+	// needs are skipped. Matches GetTerrainHeight/GetDominantBiome per column.
+	void GenerateColumnField(int32 OriginX, int32 OriginY, int32 SizeX, int32 SizeY, FTerrainColumnField& OutField) const;
+
+	// The same for every Step-th column on each axis, into plain arrays ordered X first. Used for coarse far-field
+	// terrain. OutBiomeGrid, when given, receives the biome weight grid the columns were built from; it is left
+	// empty when Step is coarser than BiomeGridStep, since only the nodes next to each sample are evaluated then.
+	void GenerateColumnGrid(int32 OriginX, int32 OriginY, int32 Step, int32 SizeX, int32 SizeY, TArray<float>& OutHeights, TArray<uint8>& OutBiomes, FBiomeWeightGrid* OutBiomeGrid = nullptr) const;
+
+	// Biome weights at every grid node needed to sample columns MinX..MaxX by MinY..MaxY, batched like the columns
+	void GenerateBiomeGrid(int32 MinX, int32 MinY, int32 MaxX, int32 MaxY, FBiomeWeightGrid& OutGrid) const;
+
+	// Rebuilds the biome weight grid of a field whose heights and biomes came from somewhere else, like a region file
+	void FillBiomeGrid(FTerrainColumnField& Field) const;
 
 protected:
 	
 
 private:	
-	float GetPlainsHeight(int X, int Y) const;
-	float GetHillsHeight(int X, int Y) const;
-	float GetMountainsHeight(int X, int Y) const;
+	FTerrainNoise Noise;
+
+	// Biomes compiled from the list above
+	FBiomeTable BiomeTable;
+
+	// Terrain height plus the primary biome the height was blended from
+	float GetTerrainHeightAndBiome(float X, float Y, uint8& OutBiome) const;
+
+	int32 GetBiomeGridStep() const { return FMath::Max(1, BiomeGridStep); }
+
+	// Weights at one node of the biome grid, straight from the noise
+	FBiomeWeights GetBiomeNodeWeights(int32 NodeX, int32 NodeY) const;
+
+	// The same for every combination of the given nodes, ordered X first
+	void EvaluateBiomeNodes(const int32* NodesX, int32 NumX, const int32* NodesY, int32 NumY, FBiomeWeights* OutWeights) const;
+
+	// A biome's terrain from its octaves, before continents, rivers and surface noise
+	float GetBiomeHeight(int32 Biome, int X, int Y) const;
 	float ApplyRivers(float X, float Y, float Height) const;
-	void PickDominantBiomes(const FBiomeWeights& Weights, EBiomeType& OutBiome1, EBiomeType& OutBiome2, float& OutBlend) const;
+
+	// The arithmetic after the noise lookups, shared by the per-sample and batched paths so both agree exactly
+	float ApplyRiverNoise(float RiverNoise, float Height) const;
+	void PickDominantBiomes(const FBiomeWeights& Weights, uint8& OutBiome1, uint8& OutBiome2, float& OutBlend) const;
 };
@@ -3,6 +3,19 @@
 #include "CoreMinimal.h"
 #include "Voxel.generated.h"
 
+// What a solid voxel is made of. Saved with the voxels, so new materials go at the end.
+UENUM(BlueprintType)
+enum class EVoxelMaterial : uint8
+{
+    // First so that air, and solid voxels placed into it, default to dirt
+    Dirt,
+    Grass,
+    Stone,
+    Snow,
+
+    Num UMETA(Hidden)
+};
+
 USTRUCT(BlueprintType)
 struct FVoxel
 {
@@ -14,6 +27,7 @@ struct FVoxel
     UPROPERTY()
     float density = 1.0f;
 
+    // An EVoxelMaterial
     UPROPERTY()
     uint8 materialID = 0;
 };
\ No newline at end of file
@@ -8,5 +8,7 @@ enum class EVoxelRenderMode : uint8
 {
 	Cubes	UMETA(DisplayName = "Cubes"),
 	MarchingCubes UMETA(DisplayName = "Smooth"),
+	// Cubes with coplanar faces merged into larger quads
+	GreedyCubes UMETA(DisplayName = "Greedy Cubes"),
 	// Add other render modes as neededs
 };
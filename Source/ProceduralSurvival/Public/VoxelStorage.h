@@ -0,0 +1,106 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Voxel.h"
+
+// Voxels for one chunk, stored as 8x8x8 bricks of separate channels instead of an FVoxel per voxel.
+//
+// - Solidity is a bitset.
+// - Density is quantized to int8 in 1/16 voxel steps and clamped to +-DensityRange. Only values close to the
+//   surface shape the smooth mesh, and clamping lets bricks away from it become uniform.
+// - Materials are indices into a per-brick palette, bit-packed to the palette size.
+//
+// Every channel of a brick collapses to a single value while the whole brick agrees on it, which is the
+// common case for air and deep ground. Get/Set work on FVoxel values; Set expands a channel when needed.
+class PROCEDURALSURVIVAL_API FVoxelStorage
+{
+public:
+	static constexpr int32 BrickSize = 8;
+	static constexpr int32 BrickVoxels = BrickSize * BrickSize * BrickSize;
+	static constexpr float DensityStep = 1.0f / 16.0f;
+	static constexpr float DensityRange = 127.0f * DensityStep;
+
+	// Resets to SizeXY x SizeXY x SizeZ voxels of empty air
+	void Init(int32 InSizeXY, int32 InSizeZ);
+
+	int32 GetSizeXY() const { return SizeXY; }
+	int32 GetSizeZ() const { return SizeZ; }
+	int32 Num() const { return SizeXY * SizeXY * SizeZ; }
+	bool IsEmpty() const { return Bricks.Num() == 0; }
+
+	bool HasSameSize(int32 InSizeXY, int32 InSizeZ) const { return SizeXY == InSizeXY && SizeZ == InSizeZ && !IsEmpty(); }
+
+	bool IsSolid(int32 X, int32 Y, int32 Z) const;
+	float GetDensity(int32 X, int32 Y, int32 Z) const;
+	uint8 GetMaterial(int32 X, int32 Y, int32 Z) const;
+	FVoxel Get(int32 X, int32 Y, int32 Z) const;
+
+	void Set(int32 X, int32 Y, int32 Z, const FVoxel& Voxel);
+
+	// Replaces a whole brick. Voxels holds BrickVoxels values ordered X, then Y, then Z; entries outside the
+	// storage (for bricks on a partial edge) are ignored. This is how generation fills storage.
+	void SetBrick(int32 BrickX, int32 BrickY, int32 BrickZ, const FVoxel* Voxels);
+
+	int32 GetNumBricksXY() const { return BricksXY; }
+	int32 GetNumBricksZ() const { return BricksZ; }
+
+	// Heap memory held by the bricks, for stats
+	SIZE_T GetAllocatedSize() const;
+
+	// The density a value reads back as once stored
+	static float StoredDensity(float Density) { return DequantizeDensity(QuantizeDensity(Density)); }
+
+	// Writes or reads the bricks as they are, collapsed channels included
+	friend PROCEDURALSURVIVAL_API FArchive& operator<<(FArchive& Ar, FVoxelStorage& Storage);
+
+private:
+	struct FBrick
+	{
+		// Per channel: the uniform value applies while the array is empty
+		bool UniformSolid = false;
+		int8 UniformDensity = 0;
+
+		TArray<uint64> SolidBits;
+		TArray<int8> Densities;
+
+		// Materials used in the brick. A single entry needs no indices, and a few fit without a heap allocation.
+		TArray<uint8, TInlineAllocator<4>> Palette;
+		TArray<uint8> MaterialIndices;
+		uint8 MaterialBits = 0;
+
+		bool IsSolid(int32 Local) const;
+		int8 GetDensity(int32 Local) const;
+		uint8 GetMaterial(int32 Local) const;
+
+		void SetSolid(int32 Local, bool bSolid);
+		void SetDensity(int32 Local, int8 Density);
+		void SetMaterial(int32 Local, uint8 Material);
+
+		// Rewrites the material indices with room for at least NewBits per voxel
+		void RepackMaterials(uint8 NewBits);
+
+		SIZE_T GetAllocatedSize() const;
+
+		void Serialize(FArchive& Ar);
+	};
+
+	int32 SizeXY = 0;
+	int32 SizeZ = 0;
+	int32 BricksXY = 0;
+	int32 BricksZ = 0;
+
+	TArray<FBrick> Bricks;
+
+	static int8 QuantizeDensity(float Density);
+	static float DequantizeDensity(int8 Quantized) { return Quantized * DensityStep; }
+
+	int32 BrickIndex(int32 X, int32 Y, int32 Z) const
+	{
+		return (X / BrickSize) + (Y / BrickSize) * BricksXY + (Z / BrickSize) * BricksXY * BricksXY;
+	}
+
+	static int32 LocalIndex(int32 X, int32 Y, int32 Z)
+	{
+		return (X % BrickSize) + (Y % BrickSize) * BrickSize + (Z % BrickSize) * BrickSize * BrickSize;
+	}
+};
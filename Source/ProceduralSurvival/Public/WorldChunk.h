@@ -3,11 +3,16 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
-#include "Voxel.h"
+#include "ChunkMesher.h"
+#include "VoxelStorage.h"
+#include "RegionStore.h"
 #include "VoxelRenderMode.h"
+#include <atomic>
 #include "WorldChunk.generated.h"
 
 class UProceduralMeshComponent;
+class UTerrainGenerator;
+class UBodySetup;
 class AWorldManager;
 
 UCLASS()
@@ -18,18 +23,79 @@ class PROCEDURALSURVIVAL_API AWorldChunk : public AActor
 public:
     AWorldChunk();
 
-    void InitializeChunk(int InChunkSizeXY, int InChunkHeightZ, float InVoxelScale, const FIntPoint& InChunkCoords);
+    void InitializeChunk(int InChunkSizeXY, int InChunkHeightZ, float InVoxelScale, const FIntVector& InChunkCoords);
 
     bool IsVoxelSolidLocal(int LocalX, int LocalY, int LocalZ) const;
 
+    // Edits one voxel. With a world manager the mesh is rebuilt once per frame for all edits made in it;
+    // without one it is rebuilt right away.
     void SetVoxelLocal(int LocalX, int LocalY, int LocalZ, bool isSolid);
 
+    // Hands over the box of voxels edited since the last call. False when nothing was edited.
+    bool ConsumeDirtyBox(FIntVector& OutMin, FIntVector& OutMax);
+
     void SetWorldManager(AWorldManager* InWorldManager) { WorldManager = InWorldManager; }
 
+    // Parks the chunk in the world manager's pool: hidden and without collision until InitializeChunk and the
+    // next mesh bring it back. The mesh component and voxel storage stay allocated for reuse.
+    void Deactivate();
+
+    // Synchronous build on the calling thread, used outside the streaming pipeline
     void GenerateMesh();
     void GenerateVoxels();
 
-    FIntPoint GetChunkCoords() const { return ChunkCoords; }
+    // Heights and biomes for a chunk column, with the mesher's padding. Only reads the generator, so it is
+    // safe on worker threads, like the other static helpers below.
+    static void GenerateColumnData(const UTerrainGenerator& TerrainGen, const FIntPoint& ColumnXY, int32 InChunkSizeXY, FTerrainColumnField& OutColumns);
+
+    // Lowest and highest section of the column that can hold a visible face or surface cell. Sections below
+    // are entirely solid and sections above entirely air. Uses the padded columns, so a cliff at the column's
+    // edge keeps the sections its side faces need.
+    static void GetSurfaceSections(const FTerrainColumnField& Columns, int32 InChunkHeightZ, int32& OutMinSection, int32& OutMaxSection);
+
+    // Fills OutVoxels for the section at ChunkCoords from its column's field. Solid voxels take their material
+    // from the column's biome by depth and slope; air is left as material 0.
+    static void GenerateVoxelData(const FBiomeTable& Biomes, const FTerrainColumnField& Columns, const FIntVector& InChunkCoords, int32 InChunkSizeXY, int32 InChunkHeightZ, FVoxelStorage& OutVoxels);
+
+    // All of the above for one column: the field, its surface range and voxels for every section in it.
+    // Checks bCancelled, when given, after the field and after each section, and returns false if it was set.
+    static bool GenerateColumnRecord(const UTerrainGenerator& TerrainGen, const FIntPoint& ColumnXY, int32 InChunkSizeXY, int32 InChunkHeightZ, FChunkColumnRecord& OutRecord,
+        const std::atomic<bool>* bCancelled = nullptr);
+
+    // Captures what a mesh build needs, including neighbour borders. Game thread only.
+    FChunkMeshInput MakeMeshInput() const;
+
+    // Takes ownership of voxels and columns built off the game thread
+    void ApplyVoxelData(FVoxelStorage&& InVoxels, FTerrainColumnField&& InColumns);
+
+    // Uploads a finished mesh. This is the only part of a chunk build that runs on the game thread; collision,
+    // when wanted, is cooked asynchronously and becomes ready some frames later.
+    void ApplyMeshData(const FChunkMeshData& MeshData);
+
+    // Whether the mesh should carry collision. Turning it on cooks the current mesh; turning it off keeps the
+    // cooked body around, so coming back into range before the next remesh costs nothing.
+    void SetWantsCollision(bool bInWantsCollision);
+
+    // Polls an async cook started by ApplyMeshData or SetWantsCollision. Returns true while it is still running.
+    // A cook that outlives CollisionCookTimeout counts as finished, so nothing waits on it forever.
+    bool UpdateCollisionCook();
+
+    // Rendering and physics become ready separately: the mesh shows as soon as it is uploaded, its collision
+    // only once the cook has finished
+    bool HasMesh() const { return bHasMesh; }
+    bool IsCollisionPending() const { return bCollisionPending; }
+    bool IsCollisionReady() const { return bHasMesh && bWantsCollision && !bCollisionPending; }
+
+    const FVoxelStorage& GetVoxelData() const { return VoxelData; }
+    bool HasVoxels() const { return bHasVoxels; }
+    int32 GetVoxelRevision() const { return VoxelRevision; }
+    int32 GetNumMeshTriangles() const { return NumMeshTriangles; }
+    const FTerrainColumnField& GetColumnField() const { return ColumnField; }
+
+    // True once voxels were edited after they were generated or loaded
+    bool IsModified() const { return bModified; }
+
+    FIntVector GetChunkCoords() const { return ChunkCoords; }
     int GetChunkSizeXY() const { return ChunkSizeXY; }
     int GetChunkHeightZ() const { return ChunkHeightZ; }
     float GetVoxelScale() const { return VoxelScale; }
@@ -46,7 +112,8 @@ private:
 
     AWorldManager* WorldManager = nullptr;
 
-    FIntPoint ChunkCoords;
+    // Chunk column X/Y and vertical section Z
+    FIntVector ChunkCoords;
 
     UPROPERTY(EditAnywhere, Category = "Chunk")
     int32 ChunkSizeXY = 32;
@@ -54,28 +121,57 @@ private:
     UPROPERTY(EditAnywhere, Category = "Chunk")
     int32 ChunkHeightZ = 32;
 
+    // Material of each voxel material's mesh section, which is also the section index
+    UPROPERTY(EditAnywhere, Category = "Chunk", meta = (ArraySizeEnum = "EVoxelMaterial"))
+    UMaterialInterface* VoxelMaterials[(int32)EVoxelMaterial::Num];
+
+    // Used for voxel materials left unset above, which the mesher gives flat debug vertex colors
     UPROPERTY(EditAnywhere, Category = "Debug")
     UMaterialInterface* BiomeDebugMaterial;
 
     float VoxelScale = 100.0f;
 
-    TArray<FVoxel> VoxelData;
+    FVoxelStorage VoxelData;
 
-    UPROPERTY()
-    EVoxelRenderMode RenderMode;
+    // Heights and biomes for the chunk's (ChunkSizeXY+3)^2 padded columns, kept so remeshing never re-runs the noise
+    FTerrainColumnField ColumnField;
 
-    void AddCubeFace(int FaceIndex, FVector& Position, FColor FaceColor, TArray<FVector>& Vertices, TArray<int32>& Triangles, TArray<FVector>& Normals, TArray<FVector2D>& UVs, TArray<FColor>& VertexColors);
+    // Set once generated voxels have been applied
+    bool bHasVoxels = false;
 
-    bool ShouldCullBottomFace(int X, int Y, int Z) const;
+    // Bumped on every voxel change so in-flight mesh builds can tell they are stale
+    int32 VoxelRevision = 0;
 
-    int LocalIndex(int X, int Y, int Z) const;
+    bool bModified = false;
+
+    // Local voxel bounds of the edits not yet handed to the world manager, empty while DirtyMin > DirtyMax
+    FIntVector DirtyMin = FIntVector(MAX_int32);
+    FIntVector DirtyMax = FIntVector(MIN_int32);
+
+    // Size of the last uploaded mesh, for comparing render modes
+    int32 NumMeshTriangles = 0;
+
+    bool bHasMesh = false;
 
-    void GenerateCubicMesh();
-    void GenerateMarchingCubesMesh();
+    bool bWantsCollision = true;
 
-    float SampleDensityAtGlobalVoxel(int GlobalX, int GlobalY, int GlobalZ) const;
+    // The uploaded section was created with collision enabled
+    bool bMeshHasCollision = false;
 
-    FVector ComputeGradient(float GX, float GY, float GZ) const;
+    // Async cooking keeps the previous body setup until the new one is cooked, then swaps it in. The cook is
+    // finished once the component's body setup is no longer the one it had when the cook started, or once it
+    // has run for CollisionCookTimeout, since a failed cook never swaps.
+    bool bCollisionPending = false;
+    TWeakObjectPtr<UBodySetup> CookStartBodySetup;
+    double CookStartTime = 0.0;
 
-    FVector VertexInterp(float IsoLevel, const FVector& P1, const FVector& P2, float ValP1, float ValP2) const;
+    void BeginCollisionCook();
+
+    // The material for the mesh section of a voxel material
+    UMaterialInterface* GetSectionMaterial(int32 Material) const;
+
+    UPROPERTY()
+    EVoxelRenderMode RenderMode;
+
+    int LocalIndex(int X, int Y, int Z) const;
 };
@@ -2,11 +2,58 @@
 
 #include "CoreMinimal.h"
 #include "WorldChunk.h"
+#include "ChunkPipeline.h"
+#include "FarFieldTerrain.h"
 #include "VoxelRenderMode.h"
 #include "TerrainGenerator.h"
 #include "GameFramework/Actor.h"
 #include "WorldManager.generated.h"
 
+// Vertical extent of the terrain in one chunk column. Only sections from MinSurfaceSection to MaxSurfaceSection
+// get a chunk actor; the ones below are all solid and the ones above all air, and this is all that is kept of them.
+struct FChunkColumn
+{
+	// Set once the column job has finished
+	bool bGenerated = false;
+
+	int32 MinSurfaceSection = 0;
+	int32 MaxSurfaceSection = -1;
+
+	// Generated from noise rather than loaded, so the region store does not have it yet
+	bool bNeedsSave = false;
+
+	// Sections were queued for their first mesh. Held back until no neighbour column is still waiting for its job.
+	bool bMeshQueued = false;
+
+	// Voxels per mesh cell for the column's sections, from its distance to CenterChunk
+	int32 LodStride = 1;
+};
+
+// Entry in the column generation heap. Lower priority values are generated first.
+struct FChunkGenRequest
+{
+	FIntPoint ColumnXY = FIntPoint::ZeroValue;
+	float Priority = 0.0f;
+
+	bool operator<(const FChunkGenRequest& Other) const { return Priority < Other.Priority; }
+};
+
+// Kinds of game-thread chunk work, each with its own measured cost in the frame budget
+enum class EChunkWorkKind : uint8
+{
+	ApplyColumn,
+	ApplyMesh,
+	ApplyFarFieldTile,
+
+	// Capturing a chunk's mesh input and voxels for a remesh job
+	DispatchRemesh,
+
+	// Column and far-field jobs, which only copy a few settings
+	DispatchJob,
+
+	Num
+};
+
 UCLASS()
 class PROCEDURALSURVIVAL_API AWorldManager : public AActor
 {
@@ -25,11 +72,33 @@ public:
 	// Convert world-space position (cm) to global voxel coordinates (voxel indices)
 	FIntVector WorldPosToGlobalVoxel(const FVector& WorldPos) const;
 
-	// Convert global voxel coords to chunk coords and local voxel coords
-	void GlobalVoxelToChunkCoords(int GlobalX, int GlobalY, int GlobalZ, FIntPoint& OutChunkXY, FIntVector& OutLocalXYZ) const;
+	// Convert global voxel coords to chunk section coords and local voxel coords
+	void GlobalVoxelToChunkCoords(int GlobalX, int GlobalY, int GlobalZ, FIntVector& OutChunkXYZ, FIntVector& OutLocalXYZ) const;
 
 	bool IsChunkWithinRenderDistance(const FIntPoint& ChunkXY) const;
 
+	// True once every section of the column under WorldPos has its collision cooked. Meshes show before their
+	// collision is ready, so anything that needs to stand on the terrain should wait for this.
+	bool IsCollisionReadyAt(const FVector& WorldPos) const;
+
+	// Sets the voxel at global voxel coordinates. Sections the column only stores as its surface range are
+	// spawned first when the edit changes them. Meshes catch up with all edits of a frame at once, on the next
+	// tick. Returns false when the voxel already had that state or its column is not generated.
+	bool SetVoxelGlobal(int GlobalVoxelX, int GlobalVoxelY, int GlobalVoxelZ, bool bSolid);
+
+	// SetVoxelGlobal for every voxel whose center lies within RadiusVoxels of CenterWorld. Returns the number changed.
+	int32 SetVoxelsInSphere(const FVector& CenterWorld, float RadiusVoxels, bool bSolid);
+
+	// Called by a chunk whose voxels were edited, to have it remeshed in the next FlushVoxelEdits
+	void MarkChunkEdited(const FIntVector& ChunkCoords);
+
+	// Snapshot the voxel layers bordering a chunk so its mesh can be built off the game thread
+	void CaptureChunkBorders(const FIntVector& ChunkCoords, FChunkMeshInput& Input) const;
+
+	// Times getting (2 * Radius + 1)^2 columns around the player by regeneration, then from a scratch region
+	// store with buffered and with mapped reads, and logs the results. Run with "voxel.BenchmarkRegionLoad [Radius]".
+	void RunRegionLoadBenchmark(int32 Radius);
+
 	UPROPERTY(EditAnywhere, Category = "World Generation")
 	EVoxelRenderMode RenderMode = EVoxelRenderMode::Cubes;
 
@@ -40,11 +109,13 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Size of chunks in voxels on the X and Y axis
 	UPROPERTY(EditAnywhere, Category = "World Generation")
 	int ChunkSizeXY = 32;
 
-	// Height of chunks in voxels on the Z axis 
+	// Height of one vertical chunk section in voxels. Columns stack as many sections as their terrain needs.
 	UPROPERTY(EditAnywhere, Category = "World Generation")
 	int ChunkHeightZ = 32;
 
@@ -56,36 +127,205 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "World Generation")
 	int RenderDistance = 4;
 
+	// Columns this many chunks from the center or farther are meshed at voxel stride 2, which doubles every
+	// LodDistance chunks further out up to MaxLodStride. 0 meshes everything at full detail.
+	UPROPERTY(EditAnywhere, Category = "World Generation|LOD", meta = (ClampMin = "0"))
+	int32 LodDistance = 4;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation|LOD", meta = (ClampMin = "1", ClampMax = "8"))
+	int32 MaxLodStride = 8;
+
+	// Only columns within this many chunks of the center get collision. Farther chunks are uploaded without it
+	// and cook it when they come into range.
+	UPROPERTY(EditAnywhere, Category = "World Generation|Collision", meta = (ClampMin = "0"))
+	int32 CollisionDistance = 2;
+
+	// Keep the player pawn's movement component off until the ground under it has collision, so it cannot
+	// fall through terrain that is drawn but still cooking
+	UPROPERTY(EditAnywhere, Category = "World Generation|Collision")
+	bool bHoldPawnUntilCollision = true;
+
 	// Chunk actor class to spawn (set to BP_WorldChunk)
 	UPROPERTY(EditAnywhere, Category = "World Generation")
 	TSubclassOf<AWorldChunk> ChunkClass;
 
+	// Draw a heightfield horizon from RenderDistance out to FarFieldDistance chunks
+	UPROPERTY(EditAnywhere, Category = "World Generation|Far Field")
+	bool bEnableFarField = true;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation|Far Field", meta = (EditCondition = "bEnableFarField", ClampMin = "0"))
+	int32 FarFieldDistance = 64;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation|Far Field", meta = (EditCondition = "bEnableFarField"))
+	TSubclassOf<AFarFieldTerrain> FarFieldClass;
+
 private:
 
 	UPROPERTY(EditAnywhere, Category = "World Generation")
 	int MaxAllowedChunks = 200;
 
-	// Active chunk map keyed by chunk coordinates
+	// Active chunk sections keyed by chunk coordinates, Z being the section
 	UPROPERTY()
-	TMap<FIntPoint, AWorldChunk*> ActiveChunks;
+	TMap<FIntVector, AWorldChunk*> ActiveChunks;
+
+	// Every chunk column within render distance, generated or not
+	TMap<FIntPoint, FChunkColumn> ActiveColumns;
+
+	// Chunk actors that left range, hidden and waiting to be reused by RegisterChunkAt
+	UPROPERTY()
+	TArray<AWorldChunk*> ChunkPool;
+
+	// Chunks released beyond this many are destroyed instead of pooled
+	UPROPERTY(EditAnywhere, Category = "World Generation", meta = (ClampMin = "0"))
+	int32 MaxPooledChunks = 256;
 
 	// Reference to the player pawn for chunk loading
 	UPROPERTY()
 	APawn* PlayerPawn = nullptr;
 
-	TArray<FIntPoint> ChunkGenQueue;
+	// Columns waiting for their column job, kept as a binary heap on priority. Priorities are only
+	// recomputed when CenterChunk changes.
+	TArray<FChunkGenRequest> ChunkGenQueue;
+
+	// Game-thread time per frame for chunk work: applying finished jobs and dispatching new ones. The workers
+	// themselves are limited by MaxChunkJobsInFlight, not by this.
+	UPROPERTY(EditAnywhere, Category = "World Generation|Budget", meta = (ClampMin = "0.1"))
+	float ChunkWorkBudgetMs = 4.0f;
 
+	// Move the budget between MinChunkWorkBudgetMs and MaxChunkWorkBudgetMs so frames stay within
+	// TargetFrameTimeMs, starting from ChunkWorkBudgetMs
+	UPROPERTY(EditAnywhere, Category = "World Generation|Budget")
+	bool bAdaptiveChunkBudget = true;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation|Budget", meta = (EditCondition = "bAdaptiveChunkBudget", ClampMin = "1"))
+	float TargetFrameTimeMs = 16.67f;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation|Budget", meta = (EditCondition = "bAdaptiveChunkBudget", ClampMin = "0.1"))
+	float MinChunkWorkBudgetMs = 1.0f;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation|Budget", meta = (EditCondition = "bAdaptiveChunkBudget", ClampMin = "0.1"))
+	float MaxChunkWorkBudgetMs = 8.0f;
+
+	// Distances are measured from where the player will be this many seconds ahead at the current velocity
+	UPROPERTY(EditAnywhere, Category = "World Generation", meta = (ClampMin = "0"))
+	float ChunkLookAheadTime = 1.0f;
+
+	// Columns outside the camera's horizontal field of view count as this much farther away
+	UPROPERTY(EditAnywhere, Category = "World Generation", meta = (ClampMin = "1"))
+	float OutOfViewPriorityScale = 2.5f;
+
+	// Budget for the current frame and when its chunk work started
+	float ChunkBudgetMs = 4.0f;
+	double ChunkWorkStartSeconds = 0.0;
+	int32 NumChunkWorkItems = 0;
+
+	// Running average of what one item of each kind costs on the game thread, in milliseconds
+	float ChunkWorkCostMs[(int32)EChunkWorkKind::Num] = {};
+
+	// Maximum number of chunk build jobs running on worker threads at once
+	UPROPERTY(EditAnywhere, Category = "World Generation", meta = (ClampMin = "1"))
+	int32 MaxChunkJobsInFlight = 8;
+
+	TUniquePtr<FChunkPipeline> ChunkPipeline;
+
+	// Keep columns in region files under Saved/Regions/RegionFolder, so edits survive unloading and revisits
+	// load instead of regenerating. Worlds with a non-zero seed get RegionFolder_Seed<N>.
 	UPROPERTY(EditAnywhere, Category = "World Generation")
-	float ChunkGenRate = 60.0f; // chunks per second
+	bool bSaveChunks = true;
+
+	UPROPERTY(EditAnywhere, Category = "World Generation", meta = (EditCondition = "bSaveChunks"))
+	FString RegionFolder = TEXT("World");
+
+	TUniquePtr<FRegionStore> RegionStore;
+
+	UPROPERTY()
+	AFarFieldTerrain* FarField = nullptr;
+
+	// Chunks waiting for a mesh rebuild once their voxels are ready and no job is running for them
+	TSet<FIntVector> ChunkRemeshQueue;
+
+	// Chunks edited since the last FlushVoxelEdits
+	TSet<FIntVector> EditedChunks;
+
+	// Remeshes caused by edits. Dispatched ahead of ChunkRemeshQueue so the player sees their edits first.
+	TSet<FIntVector> EditRemeshQueue;
+
+	// Chunks whose collision is still cooking, polled every tick
+	TSet<FIntVector> CollisionCookingChunks;
 
-	float ChunkGenAccumulator = 0.0f;
+	// The player pawn's movement is switched off until IsCollisionReadyAt its location
+	bool bPawnHeld = false;
 
 	// Current center chunk coordinates based on player position
 	FIntPoint CenterChunk = FIntPoint::ZeroValue;
 
 	void UpdateChunks();
-	void RegisterChunkAt(const FIntPoint& ChunkXY);
-	void DestroyChunkAt(const FIntPoint& ChunkXY);
-	void OnChunkCreated(const FIntPoint& ChunkXY);
-	void SortChunkQueueByDistance();
+	AWorldChunk* RegisterChunkAt(const FIntVector& ChunkCoords);
+	void DestroyChunkAt(const FIntVector& ChunkCoords);
+
+	// Takes a chunk actor from the pool, or spawns one when it is empty
+	AWorldChunk* AcquireChunk(const FVector& Location);
+	void ReleaseChunk(AWorldChunk* Chunk);
+
+	void DestroyColumnAt(const FIntPoint& ColumnXY);
+
+	// Queues the column for the region store if it is new or any of its sections were edited
+	void SaveColumnToRegion(const FIntPoint& ColumnXY, const FChunkColumn& Column);
+	void OnColumnGenerated(const FIntPoint& ColumnXY);
+
+	// Queues the column's first mesh once none of its neighbours within range is still ungenerated, corners
+	// included for smooth meshes since they read the corner padding. Each section is then meshed once while
+	// streaming instead of again for every neighbour that arrives after it.
+	void TryQueueColumnMesh(const FIntPoint& ColumnXY);
+	void QueueColumnRemesh(const FIntPoint& ColumnXY, const FChunkColumn& Column);
+
+	// Mesh stride for a column at the current CenterChunk. Always a power of two dividing the chunk sizes.
+	int32 GetLodStride(const FIntPoint& ColumnXY) const;
+
+	// Recomputes every column's stride after CenterChunk moved, remeshing the columns that changed and the
+	// neighbours whose seams changed with them
+	void UpdateLodStrides();
+
+	bool WantsCollision(const FIntPoint& ColumnXY) const;
+
+	// Turns collision on or off for every chunk whose column crossed CollisionDistance after CenterChunk moved
+	void UpdateCollisionRange();
+
+	// Drops chunks whose cook finished from CollisionCookingChunks and releases the pawn once its ground is ready
+	void PollCollisionCooks();
+	void SetPawnHeld(bool bHeld);
+	void ReprioritizeChunkQueue();
+
+	// Adapts ChunkBudgetMs to the last frame time and starts this frame's budget
+	void BeginChunkWork(float DeltaTime);
+
+	// Whether the budget has room for one more item of this kind. The first item of a frame always fits, so
+	// the queues keep draining however slow the frame is.
+	bool HasChunkBudgetFor(EChunkWorkKind Kind) const;
+
+	// Folds the time since StartSeconds into the kind's running cost
+	void RecordChunkWork(EChunkWorkKind Kind, double StartSeconds);
+
+	void DispatchGenerateJobs();
+	void DispatchGenerateJob(const FIntPoint& ColumnXY);
+
+	// Far-field tiles only use pipeline slots the voxel terrain leaves free
+	void DispatchFarFieldJobs();
+	void DispatchRemeshJobs(TSet<FIntVector>& Queue);
+
+	// Queues one remesh per edited chunk, plus the neighbours whose borders the edited boxes reach
+	void FlushVoxelEdits();
+
+	// The section's chunk, spawning it and every section between it and the column's surface range if the
+	// column only stores it as solid or air. Null when the column is not generated.
+	AWorldChunk* FindOrMaterializeChunk(const FIntVector& ChunkCoords);
+	void ProcessCompletedChunkJobs();
+	void ApplyCompletedJob(FChunkBuildJob& Job);
+	void ApplyColumnJob(FChunkBuildJob& Job);
+
+	// The section's chunk if it has voxels of the expected size
+	const AWorldChunk* FindChunkWithVoxels(const FIntVector& ChunkCoords) const;
+
+	// True for sections below a generated column's surface, which are solid without being stored
+	bool IsSectionBelowSurface(const FIntVector& ChunkCoords) const;
 };